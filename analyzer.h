@@ -0,0 +1,133 @@
+#pragma once
+
+///
+/// Recursive traversal analysis of a 64 KiB memory image
+///
+
+#include <cstdint>
+#include <array>
+#include <memory>
+#include <span>
+#include <vector>
+
+#include "mos6502.h"
+
+
+// Follows the control flow from the interrupt vectors and the user entry points,
+// separating code from data and building basic blocks and call graph
+class CodeAnalyzer
+{
+public:
+
+	// What a byte of memory has been recognized as
+	enum class ByteType : uint8_t {
+		Unknown,	// Never reached by the control flow
+		Opcode,		// First byte of an instruction
+		Operand,	// Operand byte of an instruction
+		Data		// Read as data by the control flow (vectors, indirect jump pointers)
+	};
+
+	// A sequence of instructions with a single entry and a single exit
+	struct BasicBlock {
+		uint16_t start;				// Address of the first instruction
+		uint16_t last;				// Address of the last instruction
+		uint16_t successors[2];		// Addresses of the blocks reachable from this one
+		uint8_t	 successor_count;	// Number of valid successors (0 to 2)
+	};
+
+	// A JSR instruction, from the routine that contains it to the called routine
+	struct Call {
+		uint16_t caller;	// Entry point of the calling routine
+		uint16_t site;		// Address of the JSR instruction
+		uint16_t callee;	// Address of the called routine
+	};
+
+	// Results of the analysis
+	struct Analysis {
+		// Classification of every byte of memory
+		std::array<ByteType, 0x10000> map{ };
+		// Basic blocks, sorted by start address
+		std::vector<BasicBlock> blocks;
+		// Routines entry points (vectors, user entry points and JSR targets), sorted
+		std::vector<uint16_t> routines;
+		// Call graph edges, sorted by caller and site
+		std::vector<Call> calls;
+		// Addresses where an instruction overlaps an already decoded one
+		std::vector<uint16_t> conflicts;
+	};
+
+	// How an instruction affects the control flow
+	enum class Flow {
+		Next,			// Continues with the next instruction
+		Branch,			// Conditional branch: target or next instruction
+		Jump,			// JMP absolute
+		JumpIndirect,	// JMP indirect, target read from memory
+		Call,			// JSR: target, then the next instruction when it returns
+		Stop			// RTS, RTI, BRK and KIL: the flow can't be followed further
+	};
+
+	// Interrupt vectors used as entry points
+	static constexpr uint16_t nmi_vector   = 0xFFFA;
+	static constexpr uint16_t reset_vector = 0xFFFC;
+	static constexpr uint16_t irq_vector   = 0xFFFE;
+
+public:
+
+	CodeAnalyzer();
+
+	// Adds an entry point other than the reset, NMI and IRQ vectors
+	void addEntryPoint(uint16_t address);
+
+	// Analyzes the memory image. Only the bytes the previous result depends on (code, vectors, indirect
+	// jump pointers) are compared: the result is reused if they haven't changed, or if the changes can't
+	// alter the control flow (operands and opcodes of instructions that just go to the next one, with
+	// the same length). Any other change rebuilds the whole analysis, since it can make code reachable
+	// or unreachable anywhere
+	const Analysis& analyze(std::span<const uint8_t, 0x10000> memory);
+
+	// Discards the cached result, the next analyze() starts from scratch
+	void invalidate();
+
+	// Returns true if the last analyze() call reused the cached result
+	bool reused() const;
+
+	// Returns how the instruction affects the control flow
+	static Flow flowOf(const mos6502::Disassembly& record);
+	// Returns the target of a branch
+	static uint16_t branchTarget(const mos6502::Disassembly& record);
+	// Returns the 16 bit operand of the instruction (the target of JMP and JSR)
+	static uint16_t operandWord(const mos6502::Disassembly& record);
+	// Returns the target of an instruction whose flow is Jump (JMP, or BRA on the 65C02)
+	static uint16_t jumpTarget(const mos6502::Disassembly& record);
+
+private:
+
+	// Traverses the control flow, filling result from scratch
+	void traverse(std::span<const uint8_t, 0x10000> memory);
+	// Splits the decoded instructions into basic blocks
+	void buildBlocks(std::span<const uint8_t, 0x10000> memory);
+	// Walks every routine's blocks to collect its calls
+	void buildCallGraph(std::span<const uint8_t, 0x10000> memory);
+
+	// Takes the changes of the bytes the cached result depends on, returns false if one can alter the flow
+	bool update(std::span<const uint8_t, 0x10000> memory);
+	// Returns true if the byte at address can change from the snapshot to memory without altering the flow
+	bool neutral(std::span<const uint8_t, 0x10000> memory, uint16_t address) const;
+
+private:
+
+	// User supplied entry points
+	std::vector<uint16_t> entry_points;
+
+	// Cached result, allocated on the heap because of its size
+	std::unique_ptr<Analysis> result;
+	// Memory contents seen by the cached result, only at the addresses in dependencies
+	std::unique_ptr<std::array<uint8_t, 0x10000>> snapshot;
+	// Addresses the cached result depends on (not Unknown), sorted
+	std::vector<uint16_t> dependencies;
+	// Addresses that start a basic block
+	std::vector<bool> leaders;
+
+	bool valid		 = false;
+	bool last_reused = false;
+};
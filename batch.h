@@ -0,0 +1,48 @@
+#pragma once
+
+///
+/// Parallel disassembly of many memory images
+///
+
+#include <cstdint>
+#include <cstddef>
+#include <span>
+#include <string>
+#include <vector>
+
+#include "mapped_file.h"
+
+
+// Disassembles raw images on a pool of threads, images are processed independently
+// and share no mutable state
+class BatchDisassembler
+{
+public:
+
+	// A raw image to disassemble, the bytes must stay alive during run()
+	struct Image {
+		std::span<const uint8_t> bytes;		   // Contents (at most 64 KiB are used)
+		uint16_t				 load_address; // Address of the first byte
+		std::string				 output_path;  // If not empty, the listing is written here instead of Result::text
+	};
+
+	// The outcome of the disassembly of an image
+	struct Result {
+		std::string text;				// The listing, when not written to a file
+		std::size_t instructions = 0;	// Number of instructions decoded
+		std::string error;				// Empty on success
+	};
+
+	// Uses the given number of threads (0: one for each hardware thread)
+	explicit BatchDisassembler(unsigned threads = 0);
+
+	// Disassembles every image, results have the same order of images. An exception thrown while
+	// processing an image (std::bad_alloc) is thrown here, once every thread has stopped
+	std::vector<Result> run(std::span<const Image> images) const;
+
+	// Disassembles a single image into its result, can be called concurrently
+	static void disassemble(const Image& image, Result& result);
+
+private:
+	unsigned threads;
+};
@@ -0,0 +1,387 @@
+///
+/// Benchmark of the emulator: runs a fixed set of workloads with every execution path
+/// and reports the emulated cycles and instructions per second, and the host hardware
+/// counters per emulated instruction
+///
+
+#include <cstdint>
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <exception>
+#include <fstream>
+#include <functional>
+#include <iterator>
+#include <limits>
+#include <memory>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+#include "../mos6502.h"
+#include "../loaders.h"
+#include "perf_counters.h"
+
+
+// Address of the built-in programs
+static constexpr uint16_t program_address = 0x0200;
+
+// No end address
+static constexpr uint32_t never = 0x10000;
+
+
+// A program run by the benchmark
+struct Workload {
+	std::string name;
+	std::function<void(Bus&)> load;	// Fills the memory
+	uint16_t entry;					// PC after reset
+	uint64_t cycles;				// Cycles to execute
+	uint64_t irq_period = 0;		// Cycles between two IRQ requests, 0 for none
+	uint32_t end_pc = never;		// The program restarts from entry when PC gets here
+	bool	 trap = false;			// The workload is over when an instruction jumps to itself
+	uint32_t success_pc = never;	// Address of the trap that means success
+};
+
+
+// The emulated machine
+struct Machine {
+	Bus		bus;
+	mos6502 cpu{ &bus };
+
+	Machine() { bus.cpu = &cpu; }
+};
+
+
+// Result of a run
+struct Measure {
+	uint64_t cycles = 0;
+	uint64_t instructions = 0;
+	double	 seconds = 0.0;
+	uint16_t last_pc = 0;
+	PerfCounters::Values counters;
+};
+
+
+// An execution path: executes a whole instruction
+struct Path {
+	const char* name;
+	Measure (*run)(const Workload& workload, PerfCounters& counters);
+};
+
+
+static std::vector<uint8_t> readFile(const std::string& path)
+{
+	std::ifstream file{ path, std::ios::binary };
+	if (!file)
+		throw std::runtime_error{ "Can't open " + path };
+
+	return { std::istreambuf_iterator<char>{ file }, std::istreambuf_iterator<char>{ } };
+}
+
+
+// Copies a program at address
+static void loadProgram(Bus& bus, uint16_t address, std::initializer_list<uint8_t> bytes)
+{
+	std::copy(bytes.begin(), bytes.end(), bus.ram.begin() + address);
+}
+
+
+// Points the reset and IRQ vectors to the given addresses
+static void setVectors(Bus& bus, uint16_t reset, uint16_t irq)
+{
+	bus.ram[0xFFFC] = reset & 0xFF;
+	bus.ram[0xFFFD] = reset >> 8;
+	bus.ram[0xFFFE] = irq & 0xFF;
+	bus.ram[0xFFFF] = irq >> 8;
+}
+
+
+// ADC and SBC in decimal mode, with operands changing at every iteration
+static Workload decimalWorkload()
+{
+	return { "decimal", [](Bus& bus) {
+		loadProgram(bus, program_address, {
+			0xF8,				// SED
+			0x18,				// CLC
+			0xA5, 0x10,			// loop: LDA $10
+			0x65, 0x11,			// ADC $11
+			0x85, 0x12,			// STA $12
+			0xE5, 0x13,			// SBC $13
+			0x85, 0x14,			// STA $14
+			0xE6, 0x11,			// INC $11
+			0xC6, 0x13,			// DEC $13
+			0xE8,				// INX
+			0xD0, 0xEF,			// BNE loop
+			0xE6, 0x10,			// INC $10
+			0x4C, 0x02, 0x02	// JMP loop
+		});
+		setVectors(bus, program_address, program_address);
+	}, program_address, 50'000'000 };
+}
+
+
+// Copies 16 pages with LDA (zp),Y / STA (zp),Y
+static Workload memcpyWorkload()
+{
+	return { "memcpy", [](Bus& bus) {
+		loadProgram(bus, program_address, {
+			0xA9, 0x00,			// start: LDA #$00
+			0x85, 0x00,			// STA $00
+			0x85, 0x02,			// STA $02
+			0xA9, 0x10,			// LDA #$10
+			0x85, 0x01,			// STA $01
+			0xA9, 0x20,			// LDA #$20
+			0x85, 0x03,			// STA $03
+			0xA2, 0x10,			// LDX #$10
+			0xA0, 0x00,			// LDY #$00
+			0xB1, 0x00,			// copy: LDA ($00),Y
+			0x91, 0x02,			// STA ($02),Y
+			0xC8,				// INY
+			0xD0, 0xF9,			// BNE copy
+			0xE6, 0x01,			// INC $01
+			0xE6, 0x03,			// INC $03
+			0xCA,				// DEX
+			0xD0, 0xF2,			// BNE copy
+			0x4C, 0x00, 0x02	// JMP start
+		});
+		for (std::size_t i = 0; i < 0x1000; ++i)
+			bus.ram[0x1000 + i] = static_cast<uint8_t>(i * 7);
+		setVectors(bus, program_address, program_address);
+	}, program_address, 50'000'000 };
+}
+
+
+// A busy loop interrupted every 100 cycles by an IRQ that updates a counter
+static Workload interruptWorkload()
+{
+	return { "interrupts", [](Bus& bus) {
+		loadProgram(bus, program_address, {
+			0x58,				// CLI
+			0xE8,				// loop: INX
+			0x4C, 0x01, 0x02	// JMP loop
+		});
+		loadProgram(bus, 0x0300, {
+			0x48,				// handler: PHA
+			0xE6, 0x20,			// INC $20
+			0xD0, 0x02,			// BNE done
+			0xE6, 0x21,			// INC $21
+			0x68,				// done: PLA
+			0x40				// RTI
+		});
+		setVectors(bus, program_address, 0x0300);
+	}, program_address, 50'000'000, 100 };
+}
+
+
+// Klaus Dormann's 6502_functional_test.bin, a 64 KiB image that starts at $0400 and traps at $3469 on success
+static Workload klausWorkload(const std::string& path)
+{
+	std::vector<uint8_t> image = readFile(path);
+	if (image.size() != 0x10000)
+		throw std::runtime_error{ path + " is not a 64 KiB image" };
+
+	Workload workload{ "klaus", [image](Bus& bus) {
+		loadRaw(bus, image, 0x0000);
+	}, 0x0400, 200'000'000 };
+
+	workload.trap = true;
+	workload.success_pc = 0x3469;
+	return workload;
+}
+
+
+// nestest.nes in automation mode: starts at $C000 and ends at $C66E, repeated
+static Workload nestestWorkload(const std::string& path)
+{
+	std::vector<uint8_t> image = readFile(path);
+
+	// Rejects a bad image now rather than in the middle of the measures
+	Bus check;
+	loadINes(check, image);
+
+	Workload workload{ "nestest", [image](Bus& bus) {
+		loadINes(bus, image);
+	}, 0xC000, 20'000'000 };
+
+	workload.end_pc = 0xC66E;
+	return workload;
+}
+
+
+// Brings the CPU to the entry point of the workload
+static void start(mos6502& cpu, const Workload& workload)
+{
+	cpu.reset();
+	cpu.finish();
+	cpu.PC = workload.entry;
+}
+
+
+// Runs the workload executing an instruction at a time with execute(cpu)
+// and counting the host events with counters
+template <typename Execute>
+static Measure measure(const Workload& workload, PerfCounters& counters, Execute execute)
+{
+	auto machine = std::make_unique<Machine>();
+	mos6502& cpu = machine->cpu;
+
+	workload.load(machine->bus);
+	start(cpu, workload);
+	cpu.halt_on_loops = workload.trap;
+
+	uint64_t first_cycle = cpu.clock_count;
+	uint64_t last_cycle = first_cycle + workload.cycles;
+	uint64_t next_irq = workload.irq_period ? first_cycle + workload.irq_period : std::numeric_limits<uint64_t>::max();
+	uint64_t instructions = 0;
+
+	auto begin = std::chrono::steady_clock::now();
+	counters.start();
+
+	while (cpu.clock_count < last_cycle)
+	{
+		execute(cpu);
+		++instructions;
+
+		if (cpu.clock_count >= next_irq)
+		{
+			// The interrupt sequence is not executed cycle by cycle, for every path
+			cpu.irq();
+			cpu.finish();
+			next_irq += workload.irq_period;
+		}
+
+		if (cpu.PC == workload.end_pc)
+			start(cpu, workload);
+		else if (cpu.halted() != mos6502::Halt::None)
+			break;
+	}
+
+	PerfCounters::Values values = counters.stop();
+	auto end = std::chrono::steady_clock::now();
+
+	return { cpu.clock_count - first_cycle, instructions, std::chrono::duration<double>(end - begin).count(), cpu.PC, values };
+}
+
+
+// Execution paths compared by the benchmark
+static const Path paths[] = {
+	{ "clock", [](const Workload& workload, PerfCounters& counters) {
+		return measure(workload, counters, [](mos6502& cpu) { while (!cpu.clock()); });
+	} },
+	{ "step", [](const Workload& workload, PerfCounters& counters) {
+		return measure(workload, counters, [](mos6502& cpu) { cpu.step(); });
+	} },
+#ifndef CMOS_65C02
+	{ "tick", [](const Workload& workload, PerfCounters& counters) {
+		return measure(workload, counters, [](mos6502& cpu) { while (!cpu.tick()); });
+	} },
+#endif
+};
+
+
+static void usage(const char* program)
+{
+	std::fprintf(stderr,
+		"Usage: %s [options]\n"
+		"  --klaus <file>     Runs Klaus Dormann's 6502_functional_test.bin too\n"
+		"  --nestest <file>   Runs nestest.nes too\n"
+		"  --filter <text>    Runs only the workloads whose name contains text\n"
+		"  --repeat <n>       Runs every measure n times and keeps the fastest (default 3)\n",
+		program);
+}
+
+
+int main(int argc, char* argv[])
+{
+	std::vector<Workload> workloads;
+	std::string filter;
+	int repeat = 3;
+
+	try
+	{
+		for (int i = 1; i < argc; ++i)
+		{
+			std::string option = argv[i];
+
+			if (i + 1 == argc)
+			{
+				usage(argv[0]);
+				return 2;
+			}
+
+			if (option == "--klaus")
+				workloads.push_back(klausWorkload(argv[++i]));
+			else if (option == "--nestest")
+				workloads.push_back(nestestWorkload(argv[++i]));
+			else if (option == "--filter")
+				filter = argv[++i];
+			else if (option == "--repeat")
+				repeat = std::max(1, std::atoi(argv[++i]));
+			else
+			{
+				usage(argv[0]);
+				return 2;
+			}
+		}
+	}
+	catch (const std::exception& e)
+	{
+		std::fprintf(stderr, "%s\n", e.what());
+		return 1;
+	}
+
+	workloads.push_back(decimalWorkload());
+	workloads.push_back(memcpyWorkload());
+	workloads.push_back(interruptWorkload());
+
+	PerfCounters counters;
+	if (!counters.available())
+		std::fprintf(stderr, "Hardware counters unavailable (perf_event_open failed), reported as -\n");
+
+	// Host events are reported per emulated instruction
+	std::printf("%-12s %-8s %14s %14s %10s %10s %10s", "workload", "path", "cycles", "instructions", "MHz", "MIPS", "ns/instr");
+	for (std::size_t event = 0; event < PerfCounters::event_count; ++event)
+		std::printf(" %14s", PerfCounters::name(static_cast<PerfCounters::Event>(event)));
+	std::printf("\n");
+
+	for (const Workload& workload : workloads)
+	{
+		if (workload.name.find(filter) == std::string::npos)
+			continue;
+
+		for (const Path& path : paths)
+		{
+			Measure best{ };
+			best.seconds = std::numeric_limits<double>::max();
+
+			for (int i = 0; i < repeat; ++i)
+			{
+				Measure measure = path.run(workload, counters);
+				if (measure.seconds < best.seconds)
+					best = measure;
+			}
+
+			std::printf("%-12s %-8s %14llu %14llu %10.2f %10.2f %10.2f",
+				workload.name.c_str(), path.name,
+				static_cast<unsigned long long>(best.cycles), static_cast<unsigned long long>(best.instructions),
+				best.cycles / best.seconds / 1e6, best.instructions / best.seconds / 1e6,
+				best.seconds * 1e9 / best.instructions);
+
+			for (std::size_t event = 0; event < PerfCounters::event_count; ++event)
+			{
+				if (best.counters.valid[event])
+					std::printf(" %14.3f", static_cast<double>(best.counters.counts[event]) / best.instructions);
+				else
+					std::printf(" %14s", "-");
+			}
+
+			if (workload.success_pc != never && best.last_pc != workload.success_pc)
+				std::printf("  (trapped at $%04X)", best.last_pc);
+
+			std::printf("\n");
+		}
+	}
+
+	return 0;
+}
@@ -0,0 +1,140 @@
+///
+/// Implementation of PerfCounters
+///
+
+#include <cstdint>
+
+#include "perf_counters.h"
+
+#ifdef __linux__
+#include <cstring>
+
+#include <linux/perf_event.h>
+#include <sys/ioctl.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+
+
+// Opens a counter of the calling thread, on any CPU, disabled. Returns -1 on failure
+static int openCounter(uint32_t type, uint64_t config)
+{
+	perf_event_attr attr;
+	std::memset(&attr, 0, sizeof(attr));
+
+	attr.size = sizeof(attr);
+	attr.type = type;
+	attr.config = config;
+	attr.disabled = 1;
+	attr.exclude_kernel = 1;
+	attr.exclude_hv = 1;
+	attr.read_format = PERF_FORMAT_TOTAL_TIME_ENABLED | PERF_FORMAT_TOTAL_TIME_RUNNING;
+
+	return static_cast<int>(syscall(SYS_perf_event_open, &attr, 0, -1, -1, 0));
+}
+
+
+PerfCounters::PerfCounters()
+{
+	fds[Cycles] = openCounter(PERF_TYPE_HARDWARE, PERF_COUNT_HW_CPU_CYCLES);
+	fds[Instructions] = openCounter(PERF_TYPE_HARDWARE, PERF_COUNT_HW_INSTRUCTIONS);
+	fds[BranchMisses] = openCounter(PERF_TYPE_HARDWARE, PERF_COUNT_HW_BRANCH_MISSES);
+	fds[L1dMisses] = openCounter(PERF_TYPE_HW_CACHE,
+		PERF_COUNT_HW_CACHE_L1D | (PERF_COUNT_HW_CACHE_OP_READ << 8) | (PERF_COUNT_HW_CACHE_RESULT_MISS << 16));
+}
+
+
+PerfCounters::~PerfCounters()
+{
+	for (int fd : fds)
+	{
+		if (fd >= 0)
+			close(fd);
+	}
+}
+
+
+void PerfCounters::start()
+{
+	for (int fd : fds)
+	{
+		if (fd >= 0)
+		{
+			ioctl(fd, PERF_EVENT_IOC_RESET, 0);
+			ioctl(fd, PERF_EVENT_IOC_ENABLE, 0);
+		}
+	}
+}
+
+
+PerfCounters::Values PerfCounters::stop()
+{
+	for (int fd : fds)
+	{
+		if (fd >= 0)
+			ioctl(fd, PERF_EVENT_IOC_DISABLE, 0);
+	}
+
+	Values values;
+
+	for (std::size_t event = 0; event < event_count; ++event)
+	{
+		// value, time enabled, time running
+		uint64_t data[3];
+
+		if (fds[event] < 0 || read(fds[event], data, sizeof(data)) != sizeof(data) || data[2] == 0)
+			continue;
+
+		values.counts[event] = data[2] == data[1] ? data[0]
+			: static_cast<uint64_t>(static_cast<double>(data[0]) * data[1] / data[2]);
+		values.valid[event] = true;
+	}
+
+	return values;
+}
+
+#else
+
+PerfCounters::PerfCounters()
+{
+	fds.fill(-1);
+}
+
+
+PerfCounters::~PerfCounters() = default;
+
+
+void PerfCounters::start()
+{ }
+
+
+PerfCounters::Values PerfCounters::stop()
+{
+	return { };
+}
+
+#endif
+
+
+bool PerfCounters::available() const
+{
+	for (int fd : fds)
+	{
+		if (fd >= 0)
+			return true;
+	}
+
+	return false;
+}
+
+
+const char* PerfCounters::name(Event event)
+{
+	switch (event)
+	{
+	case Cycles:	   return "cycles";
+	case Instructions: return "instructions";
+	case BranchMisses: return "branch-misses";
+	case L1dMisses:	   return "L1d-misses";
+	default:		   return "";
+	}
+}
@@ -0,0 +1,53 @@
+#pragma once
+
+///
+/// Host hardware counters read with perf_event_open (Linux only)
+///
+
+#include <cstdint>
+#include <array>
+
+
+// Counts host events of the calling thread between start() and stop().
+// Counters that can't be opened (other systems, perf_event_paranoid, virtual machines) are reported as unavailable
+class PerfCounters
+{
+public:
+
+	// Events counted
+	enum Event {
+		Cycles,
+		Instructions,
+		BranchMisses,
+		L1dMisses,		// L1 data cache read misses
+		event_count
+	};
+
+	// Values counted between start() and stop(), scaled if the kernel multiplexed the counters
+	struct Values {
+		std::array<uint64_t, event_count> counts{ };
+		std::array<bool, event_count>	  valid{ };
+	};
+
+	PerfCounters();
+	~PerfCounters();
+
+	PerfCounters(const PerfCounters&) = delete;
+	PerfCounters& operator=(const PerfCounters&) = delete;
+
+	// True if at least a counter could be opened
+	bool available() const;
+
+	// Resets and enables every counter
+	void start();
+
+	// Disables every counter and returns their values
+	Values stop();
+
+	// Short name of an event, for reports
+	static const char* name(Event event);
+
+private:
+	// File descriptors of the counters, -1 when unavailable
+	std::array<int, event_count> fds;
+};
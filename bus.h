@@ -1,31 +1,95 @@
-#pragma once
-
-///
-///	Implementation of a bus that provides 64 KiB of RAM
-/// 
-
-#include <cstdint>
-#include <array>
-
-
-class mos6502;
-
-
-// A basic bus that provides 64 KiB of RAM
-class Bus
-{
-public:
-
-	// A pointer to the instance of 6502 CPU connected to the bus
-	mos6502* cpu;
-
-
-	// Writes a byte at that address
-	void write(uint16_t address, uint8_t data);
-	// Reads the byte located at that address
-	uint8_t read(uint16_t address, bool readonly);
-	
-	// 64 KiB of RAM (initialized to 0) 
-	std::array<uint8_t, 64 * 1024> ram{ };
-};
-
+#pragma once
+
+///
+///	Implementation of a bus that provides 64 KiB of RAM and memory mapped devices
+///
+
+#include <cstdint>
+#include <array>
+#include <limits>
+#include <vector>
+
+
+class mos6502;
+
+
+// A memory mapped device (I/O chip, timer...) synchronized lazily: instead of being ticked every cycle,
+// the bus catches it up when the CPU accesses one of its pages or when its deadline is reached
+class Device
+{
+public:
+	virtual ~Device() = default;
+
+	// Runs the device for cycles, from the last synchronization
+	virtual void run(uint64_t cycles) = 0;
+
+	// Accesses a register, the device has already been caught up to the cycle of the access
+	virtual uint8_t read(uint16_t address) = 0;
+	virtual void write(uint16_t address, uint8_t data) = 0;
+
+	// Reads a register without side effects (disassembler), open bus by default
+	virtual uint8_t peek([[maybe_unused]] uint16_t address) { return 0xFF; }
+
+	// First cycle the device must be caught up at even if it's not accessed (a timer interrupt)
+	virtual uint64_t deadline() const { return never; }
+
+	static constexpr uint64_t never = std::numeric_limits<uint64_t>::max();
+
+	// Cycle the device has been caught up to, set by the bus
+	uint64_t synced = 0;
+};
+
+
+// A basic bus that provides 64 KiB of RAM
+class Bus
+{
+public:
+
+	// A pointer to the instance of 6502 CPU connected to the bus, the devices stay at cycle 0 without it
+	mos6502* cpu = nullptr;
+
+
+	// Writes a byte at that address
+	void write(uint16_t address, uint8_t data);
+	// Reads the byte located at that address, readonly reads have no side effects on devices
+	uint8_t read(uint16_t address, bool readonly);
+
+	// 64 KiB of RAM (initialized to 0)
+	std::array<uint8_t, 64 * 1024> ram{ };
+
+
+	/*									 */
+	/*			    Devices			     */
+	/*									 */
+
+	// Maps device on the pages from first_page to last_page, accesses to them don't reach the RAM.
+	// The cycle of an access is cpu->clock_count: exact with tick(), the first cycle of the
+	// instruction with clock() and step()
+	void map(Device& device, uint8_t first_page, uint8_t last_page);
+	// Gives the pages back to the RAM, the devices that are no longer mapped are removed
+	void unmap(uint8_t first_page, uint8_t last_page);
+
+	// Earliest deadline of the devices. The CPU calls update() when it reaches it, between instructions
+	uint64_t deadline() const { return next_deadline; }
+	// Catches up the devices whose deadline has been reached
+	void update(uint64_t cycle);
+	// Catches up every device (end of a frame, save states)
+	void sync(uint64_t cycle);
+	// Computes the earliest deadline again, after a device changed its own outside of an access
+	void schedule();
+
+private:
+	// Cycle of the CPU, 0 without one
+	uint64_t now() const;
+	// Runs device up to cycle
+	void catchUp(Device& device, uint64_t cycle);
+	// Drops the devices that have no page left, then computes next_deadline
+	void collect();
+
+	// Device of every page, the RAM when null
+	std::array<Device*, 256> pages{ };
+	// Every device mapped, once
+	std::vector<Device*> devices;
+
+	uint64_t next_deadline = Device::never;
+};
@@ -0,0 +1,159 @@
+#pragma once
+
+///
+/// Memory mapped devices written as C++20 coroutines
+///
+
+#include <cstdint>
+#include <coroutine>
+#include <exception>
+#include <optional>
+#include <utility>
+
+#include "bus.h"
+
+
+// A device whose behavior is a coroutine that waits for cycles of the timeline or for accesses to its
+// registers, instead of a state machine stepped every cycle. While suspended it costs nothing: the bus
+// resumes it when its wake up cycle is reached (Device::deadline()) or when the CPU accesses its pages.
+//
+//	 CoroutineDevice::Task Timer::behavior()
+//	 {
+//		 for (;;)
+//		 {
+//			 co_await cycles(period);
+//			 status |= 0x80;
+//		 }
+//	 }
+//
+//	 void Timer::store(uint16_t address, uint8_t data) { period = data * 256; }
+class CoroutineDevice : public Device
+{
+public:
+
+	// A register access made by the CPU
+	struct Access {
+		uint16_t address;
+		uint8_t  data;
+		bool	 write;
+	};
+
+	// The coroutine of a device, started by start()
+	class Task
+	{
+	public:
+		struct promise_type {
+			std::exception_ptr exception;
+
+			Task get_return_object() { return Task{ std::coroutine_handle<promise_type>::from_promise(*this) }; }
+			std::suspend_always initial_suspend() noexcept { return { }; }
+			std::suspend_always final_suspend() noexcept { return { }; }
+			void return_void() { }
+			void unhandled_exception() { exception = std::current_exception(); }
+		};
+
+		Task() = default;
+		Task(Task&& other) noexcept : handle{ std::exchange(other.handle, nullptr) } { }
+		Task& operator=(Task&& other) noexcept;
+		~Task();
+
+	private:
+		explicit Task(std::coroutine_handle<promise_type> handle) : handle{ handle } { }
+
+		std::coroutine_handle<promise_type> handle;
+
+		friend class CoroutineDevice;
+	};
+
+	CoroutineDevice() = default;
+
+	// The behavior refers to the device
+	CoroutineDevice(const CoroutineDevice&) = delete;
+	CoroutineDevice& operator=(const CoroutineDevice&) = delete;
+
+	void run(uint64_t cycles) final;
+	uint8_t read(uint16_t address) final;
+	void write(uint16_t address, uint8_t data) final;
+	uint8_t peek(uint16_t address) final { return value(address); }
+	uint64_t deadline() const final { return wake; }
+
+protected:
+
+	// Value of a register read by the CPU, without side effects: the behavior sees the read afterwards
+	virtual uint8_t value(uint16_t address) = 0;
+	// Register written by the CPU, called for every write: the behavior sees it afterwards only if it's
+	// waiting for an access
+	virtual void store([[maybe_unused]] uint16_t address, [[maybe_unused]] uint8_t data) { }
+
+	// Starts behavior, that runs until its first co_await, from the cycle the device has been synced to
+	// (call it after Bus::map(), then Bus::schedule() for the bus to see the first wake up). An exception
+	// thrown by the behavior is thrown by the bus access or the catch-up that resumed it
+	void start(Task behavior);
+
+	// Cycle of the timeline the behavior is running at
+	uint64_t now() const { return current; }
+
+
+	// co_await until(cycle): resumes the behavior at cycle (immediately if it's already passed)
+	auto until(uint64_t cycle)
+	{
+		struct Awaiter {
+			CoroutineDevice& device;
+			uint64_t cycle;
+
+			bool await_ready() const { return cycle <= device.current; }
+			void await_suspend(std::coroutine_handle<> handle) { device.suspend(handle, cycle, false); }
+			void await_resume() const { }
+		};
+
+		return Awaiter{ *this, cycle };
+	}
+
+	// co_await cycles(n): resumes the behavior n cycles later
+	auto cycles(uint64_t count) { return until(current + count); }
+
+	// co_await access(): resumes the behavior after the next register access, that it returns
+	auto access()
+	{
+		struct Awaiter {
+			CoroutineDevice& device;
+
+			bool await_ready() const { return false; }
+			void await_suspend(std::coroutine_handle<> handle) { device.suspend(handle, never, true); }
+			Access await_resume() const { return *device.last_access; }
+		};
+
+		return Awaiter{ *this };
+	}
+
+	// co_await accessBefore(cycle): same as above, resuming at cycle without an access (std::nullopt) if none comes first
+	auto accessBefore(uint64_t cycle)
+	{
+		struct Awaiter {
+			CoroutineDevice& device;
+			uint64_t cycle;
+
+			bool await_ready() const { return false; }
+			void await_suspend(std::coroutine_handle<> handle) { device.suspend(handle, cycle, true); }
+			std::optional<Access> await_resume() const { return device.last_access; }
+		};
+
+		return Awaiter{ *this, cycle };
+	}
+
+private:
+	// Suspends the behavior until wake and, if on_access, until the next register access
+	void suspend(std::coroutine_handle<> handle, uint64_t wake, bool on_access);
+	// Resumes the behavior, after setting the access it gets (if any)
+	void resume(std::optional<Access> access);
+
+	Task behavior;
+
+	// Where the behavior is suspended, null when it's running or it's finished
+	std::coroutine_handle<> suspended;
+	uint64_t wake = never;
+	bool	 waiting_access = false;
+
+	std::optional<Access> last_access;
+	uint64_t current = 0;
+};
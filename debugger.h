@@ -0,0 +1,110 @@
+#pragma once
+
+///
+/// Breakpoints and watchpoints
+///
+
+#include <cstdint>
+#include <array>
+#include <optional>
+#include <set>
+#include <unordered_map>
+
+#include "mos6502.h"
+
+
+// Runs the CPU until a breakpoint, a watchpoint or a cycle limit is reached.
+// Addresses are kept in 64 KiB bitmaps, so a check costs a single branch per instruction,
+// and run() uses the plain mos6502::step() loop when nothing is armed
+class Debugger
+{
+public:
+
+	// Why run() returned
+	enum class Reason : uint8_t {
+		Limit,		// The cycle limit has been reached
+		Breakpoint,	// PC reached a breakpoint, the instruction has not been executed yet
+		Cycle,		// clock_count reached a cycle breakpoint
+		Read,		// An instruction read a watched address (it has been executed)
+		Write,		// An instruction wrote a watched address (it has been executed)
+		Halt		// The CPU has halted (mos6502::halted())
+	};
+
+	struct Stop {
+		Reason	 reason;
+		uint16_t pc;		// PC when run() returned
+		uint16_t address;	// Address of the breakpoint or of the watched access
+		uint8_t	 value;		// Byte read or written, for watchpoints
+		uint64_t cycle;		// clock_count when run() returned
+	};
+
+	// Adds or removes an execution breakpoint
+	void setBreakpoint(uint16_t address);
+	void clearBreakpoint(uint16_t address);
+
+	// Stops as soon as clock_count reaches cycle (at the end of an instruction),
+	// the breakpoint is removed once reached
+	void breakAtCycle(uint64_t cycle);
+
+#ifdef MEMORY_HOOKS
+	// Watches the reads or the writes of the addresses from first to last (included),
+	// if value is given only the accesses of that byte stop the execution
+	void watchRead(uint16_t first, uint16_t last, std::optional<uint8_t> value = { });
+	void watchWrite(uint16_t first, uint16_t last, std::optional<uint8_t> value = { });
+#endif
+
+	// Removes the watchpoints of the addresses from first to last (included)
+	void clearWatchpoints(uint16_t first, uint16_t last);
+
+	// Removes every breakpoint and watchpoint
+	void clear();
+
+	// True if any breakpoint or watchpoint is set
+	bool armed() const;
+
+	// Executes instructions until something stops the execution or max_cycles have been executed.
+	// A breakpoint at PC is ignored for the first instruction, so that run() can resume from it.
+	// Returns at once if the CPU is halted, max_cycles can be UINT64_MAX to run without a limit
+	Stop run(mos6502& cpu, uint64_t max_cycles);
+
+private:
+
+	// One bit per address
+	class AddressSet
+	{
+	public:
+		bool test(uint16_t address) const { return (bits[address >> 6] >> (address & 63)) & 1; }
+
+		// Return true if the bit changed
+		bool set(uint16_t address);
+		bool reset(uint16_t address);
+
+		void clear() { bits.fill(0); }
+
+	private:
+		std::array<uint64_t, 1024> bits{ };
+	};
+
+	class WatchHooks;
+
+	// Adds a watchpoint, kind is Reason::Read or Reason::Write
+	void watch(Reason kind, uint16_t first, uint16_t last, std::optional<uint8_t> value);
+
+	// Key of a watchpoint value in conditions
+	static uint32_t conditionKey(Reason kind, uint16_t address);
+
+private:
+
+	AddressSet breakpoints;
+	AddressSet reads;
+	AddressSet writes;
+
+	// Number of bits set in the sets above
+	uint32_t breakpoint_count = 0;
+	uint32_t watch_count	  = 0;
+
+	// Values of the conditional watchpoints, by conditionKey()
+	std::unordered_map<uint32_t, uint8_t> conditions;
+
+	std::set<uint64_t> cycles;
+};
@@ -0,0 +1,67 @@
+#pragma once
+
+///
+/// Memory access counters, per address and per page
+///
+
+#include <cstdint>
+#include <array>
+#include <ostream>
+
+#include "hooks.h"
+
+
+// Read, write and execute counters of every address, filled by mos6502 when it's compiled with
+// MEMORY_STATISTICS and its heatmap member points to an instance. Reads include instruction fetches
+class MemoryHeatmap
+{
+public:
+
+	// Accesses to the 256 bytes of a page
+	struct Page {
+		uint64_t reads;
+		uint64_t writes;
+		uint64_t executes;
+	};
+
+	std::array<uint64_t, 0x10000> reads{ };
+	std::array<uint64_t, 0x10000> writes{ };
+	std::array<uint64_t, 0x10000> executes{ };
+
+	// Clears every counter
+	void reset();
+
+	// Copies the counters into snapshot and clears them, for periodic sampling
+	void sample(MemoryHeatmap& snapshot);
+
+	// Returns the counters summed by page
+	std::array<Page, 256> pages() const;
+
+	// Writes the counters as CSV (address,reads,writes,executes), per page or per address.
+	// Addresses never accessed are skipped
+	void writeCsv(std::ostream& out, bool per_page = false) const;
+
+	// Writes a 256x256 binary PPM image, a pixel for every address (row = page):
+	// red = writes, green = reads, blue = executes, in logarithmic scale
+	void writePpm(std::ostream& out) const;
+};
+
+
+// Hooks that count the accesses of the CPU in a heatmap, an alternative to MEMORY_STATISTICS that
+// can be combined with other hooks. Requires mos6502 compiled with MEMORY_HOOKS
+class HeatmapHooks : public NoHooks
+{
+public:
+	static constexpr bool memory = true;
+
+	explicit HeatmapHooks(MemoryHeatmap& heatmap)
+		: heatmap{ heatmap }
+	{ }
+
+	void afterInstruction([[maybe_unused]] const mos6502& cpu, uint16_t pc, [[maybe_unused]] uint8_t opcode, [[maybe_unused]] uint8_t cycles) { ++heatmap.executes[pc]; }
+	void read(uint16_t address, [[maybe_unused]] uint8_t data)  { ++heatmap.reads[address]; }
+	void write(uint16_t address, [[maybe_unused]] uint8_t data) { ++heatmap.writes[address]; }
+
+private:
+	MemoryHeatmap& heatmap;
+};
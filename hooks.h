@@ -0,0 +1,76 @@
+#pragma once
+
+///
+/// Compile-time hooks, called by the hooked overloads of mos6502::clock(), step(), irq() and nmi()
+///
+
+#include <cstdint>
+#include <tuple>
+
+
+class mos6502;
+
+
+// Default hook policy: every callback is empty, so the hooked overloads compile to the plain ones.
+// Hooks derive from NoHooks and hide only the callbacks they need, they are called without any virtual dispatch
+struct NoHooks
+{
+	// True if read() and write() must be called: requires mos6502 compiled with MEMORY_HOOKS
+	static constexpr bool memory = false;
+
+	// Called before the instruction at cpu.PC is executed, cycles left by a previous instruction are already completed
+	void beforeInstruction([[maybe_unused]] const mos6502& cpu) { }
+
+	// Called after the instruction at pc has been executed, it took cycles (penalties included)
+	void afterInstruction([[maybe_unused]] const mos6502& cpu, [[maybe_unused]] uint16_t pc, [[maybe_unused]] uint8_t opcode, [[maybe_unused]] uint8_t cycles) { }
+
+	// Called for every byte read or written by the CPU, opcode fetches included.
+	// The accesses of an instruction or interrupt are logged and reported in order after it is executed
+	void read([[maybe_unused]] uint16_t address, [[maybe_unused]] uint8_t data) { }
+	void write([[maybe_unused]] uint16_t address, [[maybe_unused]] uint8_t data) { }
+
+	// Called after an interrupt has been taken, vector is 0xFFFE (IRQ) or 0xFFFA (NMI) and cpu.PC is the handler
+	void interrupt([[maybe_unused]] const mos6502& cpu, [[maybe_unused]] uint16_t vector) { }
+};
+
+
+// Calls several hooks, in the order they're given
+template <typename... Hooks>
+class HookList
+{
+public:
+
+	static constexpr bool memory = (Hooks::memory || ...);
+
+	explicit HookList(Hooks&... hooks)
+		: hooks{ hooks... }
+	{ }
+
+	void beforeInstruction(const mos6502& cpu)
+	{
+		std::apply([&](auto&... hook) { (hook.beforeInstruction(cpu), ...); }, hooks);
+	}
+
+	void afterInstruction(const mos6502& cpu, uint16_t pc, uint8_t opcode, uint8_t cycles)
+	{
+		std::apply([&](auto&... hook) { (hook.afterInstruction(cpu, pc, opcode, cycles), ...); }, hooks);
+	}
+
+	void read(uint16_t address, uint8_t data)
+	{
+		std::apply([&](auto&... hook) { (hook.read(address, data), ...); }, hooks);
+	}
+
+	void write(uint16_t address, uint8_t data)
+	{
+		std::apply([&](auto&... hook) { (hook.write(address, data), ...); }, hooks);
+	}
+
+	void interrupt(const mos6502& cpu, uint16_t vector)
+	{
+		std::apply([&](auto&... hook) { (hook.interrupt(cpu, vector), ...); }, hooks);
+	}
+
+private:
+	std::tuple<Hooks&...> hooks;
+};
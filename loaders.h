@@ -0,0 +1,49 @@
+#pragma once
+
+///
+/// Loaders of program images: raw binaries, C64 PRG, iNES and Intel HEX
+///
+
+#include <cstdint>
+#include <optional>
+#include <span>
+#include <string>
+#include <string_view>
+
+#include "bus.h"
+
+
+// Every loader parses the image in a single pass, copies it into Bus::ram in bulk (devices mapped on
+// the same pages are bypassed) and points the reset vector to the entry point, so that mos6502::reset()
+// starts the program. Malformed or oversized images throw std::runtime_error before anything is written,
+// except Intel HEX files whose records are written as they're parsed. The *File variants map the file
+// (std::system_error, a std::runtime_error, if it can't be read)
+
+
+// What a loader has written
+struct LoadedImage {
+	uint16_t	start;	// Lowest address written
+	std::size_t size;	// Number of bytes written
+	uint16_t	entry;	// The reset vector
+};
+
+
+// Copies bytes at address. If entry isn't given it's the address, and the reset vector is left alone
+// when the image covers it (a whole 64 KiB dump)
+LoadedImage loadRaw(Bus& bus, std::span<const uint8_t> bytes, uint16_t address, std::optional<uint16_t> entry = { });
+LoadedImage loadRawFile(Bus& bus, const std::string& path, uint16_t address, std::optional<uint16_t> entry = { });
+
+// C64 PRG: the load address (little endian) followed by the program. Same entry as loadRaw()
+LoadedImage loadPrg(Bus& bus, std::span<const uint8_t> bytes, std::optional<uint16_t> entry = { });
+LoadedImage loadPrgFile(Bus& bus, const std::string& path, std::optional<uint16_t> entry = { });
+
+// iNES with mapper 0 (NROM): 16 KiB of PRG ROM are mirrored at $8000 and $C000, 32 KiB fill $8000-$FFFF.
+// The entry is the reset vector of the ROM, CHR ROM and trainer are skipped
+LoadedImage loadINes(Bus& bus, std::span<const uint8_t> bytes);
+LoadedImage loadINesFile(Bus& bus, const std::string& path);
+
+// Intel HEX: data records (00) within 64 KiB, end of file (01), extended segment or linear addresses
+// (02, 04) that keep the data in 64 KiB and start addresses (03, 05), the entry. Without a start address
+// the entry is the lowest address written. Checksums are verified, errors report the line
+LoadedImage loadIntelHex(Bus& bus, std::string_view text);
+LoadedImage loadIntelHexFile(Bus& bus, const std::string& path);
@@ -0,0 +1,41 @@
+#pragma once
+
+///
+/// Read only view of a whole file, memory mapped where the platform allows it
+///
+
+#include <cstdint>
+#include <cstddef>
+#include <memory>
+#include <span>
+#include <string>
+
+
+// A read only memory mapping of a whole file. Without mmap (sys/mman.h) the file is read in memory
+class MappedFile
+{
+public:
+
+	MappedFile() = default;
+	// Maps the file, throws std::system_error on failure
+	explicit MappedFile(const std::string& path);
+	~MappedFile();
+
+	MappedFile(MappedFile&& other) noexcept;
+	MappedFile& operator=(MappedFile&& other) noexcept;
+
+	MappedFile(const MappedFile&) = delete;
+	MappedFile& operator=(const MappedFile&) = delete;
+
+	// Contents of the file
+	std::span<const uint8_t> bytes() const;
+
+private:
+	// Unmaps the file
+	void release();
+
+	const uint8_t* data = nullptr;
+	std::size_t	   size = 0;
+	// Contents read where the file can't be mapped, data points to it
+	std::unique_ptr<uint8_t[]> copy;
+};
@@ -1,201 +1,710 @@
-#pragma once
-
-///
-/// Implementation of the MOS 6502 CPU
-/// 
-
-
-#include <cstdint>
-#include <string>
-#include <array>
-#include <map>
-
-#include "bus.h"
-
-// Binary Coded Decimal support enabled 
-#define BCD_SUPPORTED
-
-
-// A MOS 6502 processor
-class mos6502 
-{
-public:
-
-	mos6502() = default;
-	mos6502(Bus* bus);
-
-	// Executes a single clock cycles 
-	// Returns true if the processor has finished the current opcode
-	bool clock();
-
-	/*									 */
-	/*			  Interrupts		     */
-	/*									 */
-
-	// Brings the CPU to a known state 
-	void reset();
-	// Requests an maskable interrupt 
-	void irq();
-	// Executes an non-maskable interrupt
-	void nmi();
-
-
-public:
-
-	// A disassambly routine that maps every address from start_addr to end_addr to std::string
-	// that contains the instruction in that address 
-	std::map<uint16_t, std::string> disassemble(uint16_t start_addr, uint16_t end_addr) const;
-
-public:
-
-	/*									  */		
-	/*			   Registers	          */
-	/*									  */	
-	uint8_t   A  = 0x00; // Accumulator 
-	uint8_t	  X  = 0x00; // X index
-	uint8_t	  Y  = 0x00; // Y index
-	uint8_t	  P	 = 0x00; // Status register
-	uint8_t	  SP = 0x00; // Stack Pointer
-	uint16_t  PC = 0x00; // Program Counter
-
-
-public:
-	// Flags of the status register
-	// bit: 7 6 5 4 3 2 1 0 
-	//		N V U B D I Z C
-	//		| | | | | | | |
-	//		| |	| | | | | +-> Carry 
-	//		| | | | | | +---> Zero
-	//		| | | | | +-----> Interrupt Disable
-	//		| | | | +-------> Decimal 
-	//		| | | +---------> Break
-	//		| | +-----------> Unused
-	//		| +-------------> Overflow
-	//		+---------------> Negative
-	enum Flags {
-		C = 1 << 0,	// Carry bit
-		Z = 1 << 1,	// The result is zero
-		I = 1 << 2, // Interrupt disabled
-		D = 1 << 3, // Decimal mode
-		B = 1 << 4,	// Break
-		U = 1 << 5,	// Unused
-		V = 1 << 6,	// The operation caused overflow
-		N = 1 << 7	// The result is negative
-	};
-
-private:
-	// Get the status of the flag (true: set, false: clear)
-	bool getFlagStatus(Flags flag) const;
-	// Sets or clears the flag according to set variable
-	void setFlagStatus(Flags flag, bool set);
-	
-
-private:
-	/*													          */	
-	/*		     Useful variables used by the emulator            */	
-	/*															  */
-
-	// Current instruction's opcode read by clock()
-	uint8_t  opcode		 = 0x00;
-	// Number of clock cycles to execute before the next instruction
-	uint8_t  cycles		 = 0x00; 
-	// Absolute address calculated by the addressing mode
-	uint16_t abs_address = 0x0000;
-	// Relative address calculated by relative addressing mode
-	uint16_t rel_address = 0x0000;
-	// Last value fetched by clock()
-	uint8_t fetched		 = 0x00;
-public:
-	// Number of clock cycles already executed
-	uint32_t clock_count = 0;
-
-
-private:
-	/*									*/
-	/*		   Addressing modes			*/
-	/*									*/
-
-	bool IMP();	// Implicit  
-	bool ACC();	// Accumulator 
-	bool IMM();	// Immediate
-	bool ZP0();	// Page zero
-	bool ZPX();	// Page zero, offset X
-	bool ZPY();	// Page zero, offset Y
-	bool ABS();	// Absolute
-	bool ABX();	// Assolute, offset X
-	bool ABY();	// Assolute, offset Y
-	bool IND();	// Indirect
-	bool IXD();	// Indexed Indirect
-	bool IYD();	// Indirect Indexed
-	bool REL();	// Relative
-
-	// Returns the data to be processed by the instruction 
-	uint8_t fetch();
-
-
-private:
-	/*											 */
-	/*			    Instructions				 */
-	/*											 */
-
-	bool ADC(); bool AND(); bool ASL(); bool BCC();
-	bool BCS(); bool BEQ(); bool BIT(); bool BMI(); 
-	bool BNE(); bool BPL(); bool BRK(); bool BVC();
-	bool BVS(); bool CLC(); bool CLD(); bool CLI();
-	bool CLV(); bool CMP(); bool CPX(); bool CPY();
-	bool DEC(); bool DEX(); bool DEY(); bool EOR();
-	bool INC(); bool INX(); bool INY(); bool JMP();
-	bool JSR(); bool LDA(); bool LDX(); bool LDY();
-	bool LSR(); bool NOP(); bool ORA(); bool PHA();
-	bool PHP(); bool PLA(); bool PLP(); bool ROL();
-	bool ROR(); bool RTI(); bool RTS(); bool SBC();
-	bool SEC(); bool SED(); bool SEI(); bool STA();
-	bool STX(); bool STY(); bool TAX(); bool TAY();
-	bool TSX(); bool TXA(); bool TXS(); bool TYA();
-
-
-private:
-	/*											 */
-	/*		    (some) Illegal opcodes		     */
-	/*											 */
-
-	bool AAX(); bool ANC(); bool ARR(); bool ASR();
-	bool ATX(); bool AXA(); bool DCP(); bool ISC(); 
-	bool KIL(); bool LAS(); bool LAX(); bool RLA(); 
-	bool RRA(); bool SAX(); bool SLO(); bool SRE(); 
-	bool SXA(); bool SYA(); bool TAS(); bool XAA();
-
-	
-	/*                                       */
-	/*                  Bus                  */
-	/*                                       */
-
-public:
-	// The bus connected to the CPU
-	Bus* bus;
-
-private:
-	// Writes a byte in at given address
-	void write(uint16_t address, uint8_t data);
-	// Reads the byte pointed by the address
-	uint8_t read(uint16_t address) const;
-
-
-private:
-
-	/*																	   */
-	/*		                  Instructions utilities				       */
-	/*																	   */
-
-	// Structure that represent an instruction
-	struct Instruction {
-		std::string name;				  // The instruction's name
-		bool (mos6502::* operation)();	  // Pointer to instruction's routine
-		bool (mos6502::* address_mode)(); // Pointer to an addressing mode
-		uint8_t cycles;					  // Number of cycles required 
-	};
-
-	// Array that contains all instructions
-	static std::array<Instruction, 256> lookup;
-};
-
+#pragma once
+
+///
+/// Implementation of the MOS 6502 CPU
+/// 
+
+
+#include <cstdint>
+#include <string>
+#include <array>
+#include <map>
+#include <span>
+#include <string_view>
+
+#include "bus.h"
+#include "hooks.h"
+
+class SymbolTable;
+class MemoryHeatmap;
+class TrapTable;
+
+
+// Binary Coded Decimal support enabled 
+#define BCD_SUPPORTED
+
+// WDC 65C02 instead of the NMOS 6502: CMOS instructions and addressing modes, undefined opcodes
+// are NOPs, no JMP ($xxFF) bug, valid N and Z flags in decimal mode and CMOS timing. Disabled by default
+// #define CMOS_65C02
+
+// Per-opcode execution statistics, disabled by default: when not defined they cost nothing
+// #define OPCODE_STATISTICS
+
+// Per-address memory access counters, disabled by default: when not defined they cost nothing
+// #define MEMORY_STATISTICS
+
+// Log of the memory accesses of every instruction, required by hooks that observe reads and writes
+// (see hooks.h), disabled by default: when not defined it costs nothing
+// #define MEMORY_HOOKS
+
+// Native handlers that replace ROM routines (see traps.h), disabled by default: when not defined they cost nothing
+// #define HLE_TRAPS
+
+
+// A MOS 6502 processor
+class mos6502 
+{
+public:
+
+	mos6502() = default;
+	mos6502(Bus* bus);
+
+	// Executes a single clock cycles 
+	// Returns true if the processor has finished the current opcode
+	bool clock();
+
+	// Executes a whole instruction at once, after completing the cycles left by clock(),
+	// reset() or an interrupt. Returns the number of cycles of the instruction, 0 without
+	// running any cycle while the CPU is halted (see halted())
+	uint8_t step();
+
+	// Completes the cycles left by clock(), reset() or an interrupt, without starting a new instruction
+	void finish();
+
+#ifndef CMOS_65C02
+	// Executes a single clock cycle of the microcoded core: every cycle makes one bus access, in the
+	// order of the real hardware (dummy reads and writes included). Slower than clock(), for machines
+	// that need cycle exact I/O. Interrupts and reset() make their accesses at once, like with clock().
+	// Called between two tick() of an instruction, irq() and nmi() complete it first (its remaining
+	// cycles run at once) and reset() abandons it.
+	// Returns true if the processor has finished the current instruction (or interrupt sequence)
+	bool tick();
+#endif
+
+	// Same as clock() and step(), calling hooks around every instruction (see hooks.h), not around the
+	// idle cycles of a halted CPU
+	template <typename Hooks>
+	bool clock(Hooks& hooks);
+	template <typename Hooks>
+	uint8_t step(Hooks& hooks);
+#ifndef CMOS_65C02
+	template <typename Hooks>
+	bool tick(Hooks& hooks);
+#endif
+
+	/*									 */
+	/*			  Interrupts		     */
+	/*									 */
+
+	// Brings the CPU to a known state 
+	void reset();
+	// Requests an maskable interrupt 
+	void irq();
+	// Executes an non-maskable interrupt
+	void nmi();
+
+	// Same as irq() and nmi(), calling hooks when the interrupt is taken
+	template <typename Hooks>
+	void irq(Hooks& hooks);
+	template <typename Hooks>
+	void nmi(Hooks& hooks);
+
+
+	/*									 */
+	/*			     Halt			     */
+	/*									 */
+
+	// Why the CPU has stopped fetching instructions: while halted, clock() and step() run idle cycles
+	enum class Halt : uint8_t {
+		None,			// Running
+		Jam,			// KIL (JAM) opcode, PC on it. Until reset(), interrupts are ignored
+		Stop,			// STP (65C02). Until reset(), interrupts are ignored
+		JumpToSelf,		// JMP to its own address (halt_on_loops), until an interrupt is taken
+		BranchToSelf	// Branch taken to its own address (halt_on_loops), until an interrupt is taken
+	};
+
+	// Returns Halt::None while the CPU runs, run loops check it to stop at once
+	Halt halted() const { return halt; }
+
+	// Halts on the jumps and the branches to themselves, that only an interrupt can leave: the traps of
+	// the Klaus Dormann tests, the end of a program waiting for nothing. Disabled by default
+	bool halt_on_loops = false;
+
+
+public:
+
+	// Addressing modes, as reported by the disassembler (ZPI, IAX and ZPR are used only by the 65C02)
+	enum class AddressMode : uint8_t {
+		IMP, ACC, IMM, ZP0, ZPX, ZPY, ABS, ABX, ABY, IND, IXD, IYD, REL, ZPI, IAX, ZPR
+	};
+
+	// A decoded instruction, filled by the disassembler without any allocation
+	struct Disassembly {
+		uint16_t	address;	 // Address of the opcode
+		uint8_t		opcode;		 // The opcode
+		AddressMode mode;		 // Addressing mode of the instruction
+		uint8_t		operands[2]; // Operand bytes (only the first length - 1 are meaningful)
+		uint8_t		length;		 // Size of the instruction in bytes (1 to 3)
+		uint8_t		cycles;		 // Base number of cycles, without page crossing or branch penalties
+	};
+
+	// Size of a buffer that can contain any formatted instruction (null terminator included)
+	static constexpr std::size_t max_format_length = 16;
+
+	// A disassambly routine that maps every address from start_addr to end_addr to std::string
+	// that contains the instruction in that address 
+	std::map<uint16_t, std::string> disassemble(uint16_t start_addr, uint16_t end_addr) const;
+
+	// Same as above, printing symbol names instead of the addresses that have one. Branch, JMP and JSR
+	// targets without a symbol are named L_XXXX when an instruction of the range starts there, other
+	// targets stay addresses. The instructions at a named address start with a "name:" line
+	std::map<uint16_t, std::string> disassemble(uint16_t start_addr, uint16_t end_addr, const SymbolTable& symbols) const;
+
+	// Decodes instructions from start_addr to end_addr into records, stopping when records is full
+	// Returns the number of records filled
+	std::size_t disassemble(uint16_t start_addr, uint16_t end_addr, std::span<Disassembly> records) const;
+
+	// Decodes the instruction located at address
+	Disassembly decode(uint16_t address) const;
+
+	// Decodes the instruction located at address of a 64 KiB memory image, no CPU required
+	static Disassembly decode(std::span<const uint8_t, 0x10000> memory, uint16_t address);
+
+	// Writes the textual representation of record into buffer (null terminated, truncated if needed)
+	// Returns the number of characters written, null terminator excluded
+	static std::size_t format(const Disassembly& record, std::span<char> buffer);
+
+	// Same as above, printing symbol names instead of the addresses that have one
+	static std::size_t format(const Disassembly& record, std::span<char> buffer, const SymbolTable& symbols);
+
+	// Returns the three letters name of the opcode
+	static std::string_view mnemonic(uint8_t opcode);
+
+	// Returns the addressing mode used by the opcode
+	static AddressMode addressMode(uint8_t opcode);
+
+	// Returns the size in bytes of the instruction
+	static uint8_t length(uint8_t opcode);
+
+	// Returns the number of cycles of the opcode, without penalties
+	static uint8_t baseCycles(uint8_t opcode);
+
+	// Returns true if the opcode takes another cycle when its address crosses a page
+	// (branches excluded, their penalty depends on the target)
+	static bool pagePenalty(uint8_t opcode);
+
+	// Returns true for the opcodes that are not in the datasheet: illegal opcodes of the NMOS 6502, extra
+	// NOPs of both CPUs, and the NMOS copy of SBC #imm at $EB
+	static bool undocumented(uint8_t opcode);
+
+public:
+
+	/*									  */		
+	/*			   Registers	          */
+	/*									  */	
+	uint8_t   A  = 0x00; // Accumulator 
+	uint8_t	  X  = 0x00; // X index
+	uint8_t	  Y  = 0x00; // Y index
+	uint8_t	  P	 = 0x00; // Status register
+	uint8_t	  SP = 0x00; // Stack Pointer
+	uint16_t  PC = 0x00; // Program Counter
+
+
+public:
+	// Flags of the status register
+	// bit: 7 6 5 4 3 2 1 0 
+	//		N V U B D I Z C
+	//		| | | | | | | |
+	//		| |	| | | | | +-> Carry 
+	//		| | | | | | +---> Zero
+	//		| | | | | +-----> Interrupt Disable
+	//		| | | | +-------> Decimal 
+	//		| | | +---------> Break
+	//		| | +-----------> Unused
+	//		| +-------------> Overflow
+	//		+---------------> Negative
+	enum Flags {
+		C = 1 << 0,	// Carry bit
+		Z = 1 << 1,	// The result is zero
+		I = 1 << 2, // Interrupt disabled
+		D = 1 << 3, // Decimal mode
+		B = 1 << 4,	// Break
+		U = 1 << 5,	// Unused
+		V = 1 << 6,	// The operation caused overflow
+		N = 1 << 7	// The result is negative
+	};
+
+private:
+	// Decodes and executes the instruction at PC, setting the cycles it requires
+	void execute();
+
+	// Same as above, calling hooks around the instruction
+	template <typename Hooks>
+	void execute(Hooks& hooks);
+
+#ifndef CMOS_65C02
+	// A cycle of an instruction in the microcoded core
+	enum class MicroOp : uint8_t;
+
+	// Longest sequence after the opcode fetch: read-modify-write with (zp),Y
+	static constexpr std::size_t max_micro_ops = 7;
+
+	// Sequences of the cycles of every opcode, after its fetch
+	static const std::array<std::array<MicroOp, max_micro_ops>, 256>& microcode();
+
+	// Executes a cycle of the current instruction for tick()
+	void microStep(MicroOp op);
+	// Runs the cycles left of an instruction started by tick(), before an interrupt
+	void completeInstruction();
+#endif
+
+	// Halts if the instruction at address, just executed, jumped or branched to itself
+	void detectLoop(uint16_t address);
+
+	// True if only reset() can leave the halt (JAM, STP)
+	bool locked() const { return halt == Halt::Jam || halt == Halt::Stop; }
+	// True if the CPU runs idle cycles instead of instructions (halted, or in WAI), hooks don't see them
+	bool idle() const
+	{
+#ifdef CMOS_65C02
+		if (waiting)
+			return true;
+#endif
+		return halt != Halt::None;
+	}
+
+	// Catches up the devices whose deadline has been reached, between two instructions. A device can
+	// request an interrupt, whose cycles are spent before the next instruction
+	void updateDevices() { if (clock_count >= bus->deadline()) bus->update(clock_count); }
+
+#ifdef HLE_TRAPS
+	// Runs the trap at PC instead of the instruction. Its cycles are spent up to 255 at a time, with PC
+	// on the trap (reported to hooks as NOP), and the last ones return to the caller (reported as RTS)
+	void trap();
+#endif
+
+private:
+	// Get the status of the flag (true: set, false: clear)
+	bool getFlagStatus(Flags flag) const;
+	// Sets or clears the flag according to set variable
+	void setFlagStatus(Flags flag, bool set);
+	
+
+private:
+	/*													          */	
+	/*		     Useful variables used by the emulator            */	
+	/*															  */
+
+	// Current instruction's opcode read by clock()
+	uint8_t  opcode		 = 0x00;
+	// Number of clock cycles to execute before the next instruction
+	uint8_t  cycles		 = 0x00; 
+	// Absolute address calculated by the addressing mode
+	uint16_t abs_address = 0x0000;
+	// Relative address calculated by relative addressing mode
+	uint16_t rel_address = 0x0000;
+	// Last value fetched by clock()
+	uint8_t fetched		 = 0x00;
+	// Set by KIL, STP and the loops detected with halt_on_loops
+	Halt halt			 = Halt::None;
+#ifdef CMOS_65C02
+	// Set by WAI until an interrupt
+	bool waiting		 = false;
+#endif
+#ifdef HLE_TRAPS
+	// Traps interrupted between their parts, the innermost last: an interrupt handler can run other traps
+	// (or the same one again), each part resumes only from its own address and stack pointer
+	struct PendingTrap {
+		uint16_t address;
+		uint8_t	 stack;
+		uint32_t cycles;	// Still to be spent
+	};
+	std::array<PendingTrap, 4> pending_traps{ };
+	uint8_t pending_count = 0;
+#endif
+#ifndef CMOS_65C02
+	// Cycles of the current instruction already executed by tick(), 0 between instructions
+	uint8_t	 micro_cycle = 0;
+	// Kept by tick() between cycles: base of an indexed address, zero page pointer, PC before a branch
+	uint16_t micro_base	 = 0x0000;
+	// Address of the instruction executed by tick(), reported to hooks
+	uint16_t micro_pc	 = 0x0000;
+	// Set by tick() when the indexed address of the current instruction crossed a page
+	bool	 micro_crossed = false;
+#endif
+public:
+	// Number of clock cycles already executed
+	uint64_t clock_count = 0;
+
+#ifdef OPCODE_STATISTICS
+	// Counters updated by every instruction, indexed by opcode like lookup
+	struct Statistics {
+		std::array<uint64_t, 256> executions{ };		  // Times the opcode has been executed
+		std::array<uint64_t, 256> cycles{ };			  // Cycles spent, penalties included
+		std::array<uint64_t, 256> page_crosses{ };		  // Extra cycles for crossing a page (ABX, ABY, IYD)
+		std::array<uint64_t, 256> branches_taken{ };	  // Branches taken
+		std::array<uint64_t, 256> branch_page_crosses{ }; // Branches taken to another page
+		std::array<uint64_t, 16>  cycle_histogram{ };	  // Number of instructions, by number of cycles
+
+		// Clears every counter
+		void reset() { *this = Statistics{ }; }
+	};
+
+	Statistics statistics;
+
+private:
+	// Updates the statistics with the instruction just decoded by clock() or completed by tick()
+	void countInstruction(uint8_t instruction_cycles, bool page_crossed);
+#endif
+
+
+private:
+	/*									*/
+	/*		   Addressing modes			*/
+	/*									*/
+
+	bool IMP();	// Implicit  
+	bool ACC();	// Accumulator 
+	bool IMM();	// Immediate
+	bool ZP0();	// Page zero
+	bool ZPX();	// Page zero, offset X
+	bool ZPY();	// Page zero, offset Y
+	bool ABS();	// Absolute
+	bool ABX();	// Assolute, offset X
+	bool ABY();	// Assolute, offset Y
+	bool IND();	// Indirect
+	bool IXD();	// Indexed Indirect
+	bool IYD();	// Indirect Indexed
+	bool REL();	// Relative
+#ifdef CMOS_65C02
+	bool ZPI();	// Zero page indirect
+	bool IAX();	// Absolute indexed indirect, offset X
+	bool ZPR();	// Zero page and relative (BBR, BBS)
+#endif
+
+	// Returns the data to be processed by the instruction 
+	uint8_t fetch();
+
+
+private:
+	/*											 */
+	/*			    Instructions				 */
+	/*											 */
+
+	bool ADC(); bool AND(); bool ASL(); bool BCC();
+	bool BCS(); bool BEQ(); bool BIT(); bool BMI(); 
+	bool BNE(); bool BPL(); bool BRK(); bool BVC();
+	bool BVS(); bool CLC(); bool CLD(); bool CLI();
+	bool CLV(); bool CMP(); bool CPX(); bool CPY();
+	bool DEC(); bool DEX(); bool DEY(); bool EOR();
+	bool INC(); bool INX(); bool INY(); bool JMP();
+	bool JSR(); bool LDA(); bool LDX(); bool LDY();
+	bool LSR(); bool NOP(); bool ORA(); bool PHA();
+	bool PHP(); bool PLA(); bool PLP(); bool ROL();
+	bool ROR(); bool RTI(); bool RTS(); bool SBC();
+	bool SEC(); bool SED(); bool SEI(); bool STA();
+	bool STX(); bool STY(); bool TAX(); bool TAY();
+	bool TSX(); bool TXA(); bool TXS(); bool TYA();
+
+#ifdef CMOS_65C02
+private:
+	/*											 */
+	/*		      65C02 instructions		     */
+	/*											 */
+
+	bool BBR(); bool BBS(); bool BRA(); bool PHX();
+	bool PHY(); bool PLX(); bool PLY(); bool RMB();
+	bool SMB(); bool STP(); bool STZ(); bool TRB();
+	bool TSB(); bool WAI();
+#endif
+
+
+private:
+	/*											 */
+	/*		    (some) Illegal opcodes		     */
+	/*											 */
+
+	bool AAX(); bool ANC(); bool ARR(); bool ASR();
+	bool ATX(); bool AXA(); bool DCP(); bool ISC(); 
+	bool KIL(); bool LAS(); bool LAX(); bool RLA(); 
+	bool RRA(); bool SAX(); bool SLO(); bool SRE(); 
+	bool SXA(); bool SYA(); bool TAS(); bool XAA();
+
+	
+	/*                                       */
+	/*                  Bus                  */
+	/*                                       */
+
+public:
+	// The bus connected to the CPU
+	Bus* bus;
+
+#ifdef MEMORY_STATISTICS
+	// Counters of the accesses made by read(), write() and instruction fetches, nothing is counted when null
+	MemoryHeatmap* heatmap = nullptr;
+#endif
+
+#ifdef HLE_TRAPS
+	// Native replacements of routines, nothing is trapped when null
+	TrapTable* traps = nullptr;
+#endif
+
+private:
+#ifdef MEMORY_HOOKS
+	// A memory access made by read() or write()
+	struct Access {
+		uint16_t address;
+		uint8_t  data;
+		bool	 write;
+	};
+
+	// Enough for any instruction or interrupt, further accesses are not logged
+	static constexpr std::size_t max_accesses = 16;
+
+	// Accesses of the current instruction, reported to the hooks once it has been executed
+	mutable std::array<Access, max_accesses> accesses{ };
+	mutable uint8_t access_count = 0;
+#endif
+
+	// Clears the access log, before the instruction or interrupt reported to hooks
+	template <typename Hooks>
+	void beginAccesses();
+	// Reports the logged accesses to hooks
+	template <typename Hooks>
+	void reportAccesses(Hooks& hooks);
+
+private:
+	// Writes a byte in at given address
+	void write(uint16_t address, uint8_t data);
+	// Reads the byte pointed by the address
+	uint8_t read(uint16_t address) const;
+
+
+private:
+
+	/*																	   */
+	/*		                  Instructions utilities				       */
+	/*																	   */
+
+	// Routines of the instructions, index of operations
+	enum class Operation : uint8_t {
+		ADC, AND, ASL, BCC, BCS, BEQ, BIT, BMI,
+		BNE, BPL, BRK, BVC, BVS, CLC, CLD, CLI,
+		CLV, CMP, CPX, CPY, DEC, DEX, DEY, EOR,
+		INC, INX, INY, JMP, JSR, LDA, LDX, LDY,
+		LSR, NOP, ORA, PHA, PHP, PLA, PLP, ROL,
+		ROR, RTI, RTS, SBC, SEC, SED, SEI, STA,
+		STX, STY, TAX, TAY, TSX, TXA, TXS, TYA,
+		AAX, ANC, ARR, ASR, ATX, AXA, DCP, ISC,
+		KIL, LAS, LAX, RLA, RRA, SAX, SLO, SRE,
+		SXA, SYA, TAS, XAA,
+#ifdef CMOS_65C02
+		BBR, BBS, BRA, PHX, PHY, PLX, PLY, RMB,
+		SMB, STP, STZ, TRB, TSB, WAI,
+#endif
+		count
+	};
+
+	// Hot metadata of an opcode, packed in 4 bytes: the whole table takes 1 KiB
+	struct Instruction {
+		Operation	operation;			// Routine of the instruction
+		AddressMode mode;				// Addressing mode
+		uint8_t		cycles;				// Number of cycles required, without penalties
+		bool		page_penalty : 1;	// Takes another cycle when the indexed address crosses a page
+		bool		no_fetch	 : 1;	// The operand isn't read (stores, jumps, branches)
+
+		constexpr Instruction(Operation operation, AddressMode mode, uint8_t cycles);
+	};
+
+	// Array that contains all instructions, built at compile time
+	static const std::array<Instruction, 256> lookup;
+
+	// Routines of the instructions and of the addressing modes, indexed by Instruction::operation and Instruction::mode
+	static const std::array<bool (mos6502::*)(), static_cast<std::size_t>(Operation::count)> operations;
+	static const std::array<bool (mos6502::*)(), 16> address_modes;
+
+	// Names of the opcodes, apart from the hot metadata since only the disassembler needs them
+	static const std::array<std::string_view, 256> mnemonics;
+
+	// Decodes the instruction at address, reading its bytes with read(uint16_t)
+	template <typename Reader>
+	static Disassembly decode(uint16_t address, Reader read);
+};
+
+
+/*																	   */
+/*		                   Instructions table					       */
+/*																	   */
+
+constexpr mos6502::Instruction::Instruction(Operation operation, AddressMode mode, uint8_t cycles)
+	: operation{ operation }, mode{ mode }, cycles{ cycles }, page_penalty{ false }, no_fetch{ false }
+{
+	using enum Operation;
+
+	// Instructions that return true ("can require another cycle") with an indexed addressing mode
+	if (mode == AddressMode::ABX || mode == AddressMode::ABY || mode == AddressMode::IYD)
+	{
+		page_penalty = operation == ADC || operation == AND || operation == CMP || operation == EOR ||
+					   operation == LDA || operation == LDX || operation == LDY || operation == ORA ||
+					   operation == SBC || operation == LAX || (operation == NOP && mode == AddressMode::ABX);
+#ifdef CMOS_65C02
+		page_penalty = page_penalty || (mode == AddressMode::ABX &&
+					   (operation == ASL || operation == LSR || operation == ROL || operation == ROR || operation == BIT));
+#endif
+	}
+
+	// Stores, jumps and branches don't use the data: reading it could have side effects on a device
+	no_fetch = mode == AddressMode::REL ||
+			   operation == STA || operation == STX || operation == STY || operation == AAX ||
+			   operation == SAX || operation == AXA || operation == SXA || operation == SYA ||
+			   operation == TAS || operation == JMP || operation == JSR;
+#ifdef CMOS_65C02
+	no_fetch = no_fetch || operation == STZ;
+#endif
+}
+
+
+/*																	   */
+/*		                   Hooked execution						       */
+/*																	   */
+
+template <typename Hooks>
+bool mos6502::clock(Hooks& hooks)
+{
+	if (cycles == 0)
+		updateDevices();
+	if (cycles == 0)
+		execute(hooks);
+
+	--cycles;
+
+	// Increment the number of cycles executed
+	++clock_count;
+
+	return cycles == 0;
+}
+
+
+template <typename Hooks>
+uint8_t mos6502::step(Hooks& hooks)
+{
+	finish();
+	updateDevices();
+	finish();
+
+	if (halt != Halt::None)
+		return 0;
+
+	execute(hooks);
+
+	uint8_t executed = cycles;
+	clock_count += cycles;
+	cycles = 0;
+
+	return executed;
+}
+
+
+#ifndef CMOS_65C02
+template <typename Hooks>
+bool mos6502::tick(Hooks& hooks)
+{
+	if (cycles == 0 && micro_cycle == 0)
+		updateDevices();
+
+	// A new instruction starts when nothing is left to complete, and the CPU isn't idle
+	bool starting = cycles == 0 && micro_cycle == 0 && !idle();
+	bool instruction = starting || micro_cycle != 0;
+	uint8_t executed = micro_cycle;
+
+	if (starting)
+	{
+		micro_pc = PC;
+		hooks.beforeInstruction(*this);
+	}
+
+	beginAccesses<Hooks>();
+	bool finished = tick();
+	reportAccesses(hooks);
+
+	if (finished && instruction)
+		hooks.afterInstruction(*this, micro_pc, opcode, executed + 1);
+
+	return finished;
+}
+#endif
+
+
+template <typename Hooks>
+void mos6502::irq(Hooks& hooks)
+{
+	if (getFlagStatus(I) || locked())
+	{
+#ifdef CMOS_65C02
+		// A masked interrupt still resumes WAI, it isn't taken
+		irq();
+#endif
+		return;
+	}
+
+	beginAccesses<Hooks>();
+	irq();
+	reportAccesses(hooks);
+
+	hooks.interrupt(*this, 0xFFFE);
+}
+
+
+template <typename Hooks>
+void mos6502::nmi(Hooks& hooks)
+{
+	if (locked())
+		return;
+
+	beginAccesses<Hooks>();
+	nmi();
+	reportAccesses(hooks);
+
+	hooks.interrupt(*this, 0xFFFA);
+}
+
+
+template <typename Hooks>
+void mos6502::execute(Hooks& hooks)
+{
+	if (idle())
+	{
+		execute();
+		return;
+	}
+
+	uint16_t pc = PC;
+
+	hooks.beforeInstruction(*this);
+
+	beginAccesses<Hooks>();
+	execute();
+	reportAccesses(hooks);
+
+	hooks.afterInstruction(*this, pc, opcode, cycles);
+}
+
+
+template <typename Hooks>
+void mos6502::beginAccesses()
+{
+#ifdef MEMORY_HOOKS
+	if constexpr (Hooks::memory)
+		access_count = 0;
+#else
+	static_assert(!Hooks::memory, "hooks that observe memory accesses require MEMORY_HOOKS");
+#endif
+}
+
+
+template <typename Hooks>
+void mos6502::reportAccesses([[maybe_unused]] Hooks& hooks)
+{
+#ifdef MEMORY_HOOKS
+	if constexpr (Hooks::memory)
+	{
+		for (uint8_t i = 0; i < access_count; ++i)
+		{
+			if (accesses[i].write)
+				hooks.write(accesses[i].address, accesses[i].data);
+			else
+				hooks.read(accesses[i].address, accesses[i].data);
+		}
+	}
+#endif
+}
@@ -0,0 +1,151 @@
+#ifndef MOS6502_C_H
+#define MOS6502_C_H
+
+///
+/// Stable C interface of a 6502 machine (mos6502 and a Bus with 64 KiB of RAM), for FFI bindings
+///
+
+#include <stddef.h>
+#include <stdint.h>
+
+
+// Every call crossing the interface is meant to do a substantial amount of work: cycles are run,
+// memory is copied and trace records are drained in batches. Structs have fixed-width fields and
+// explicit padding, they are only extended at the end together with MOS6502_C_ABI_VERSION.
+// No C++ exception crosses the interface: failures are reported as MOS6502_C_ERROR_* codes
+
+#if defined(_WIN32)
+#	if defined(MOS6502_C_BUILD)
+#		define MOS6502_C_API __declspec(dllexport)
+#	else
+#		define MOS6502_C_API __declspec(dllimport)
+#	endif
+#else
+#	define MOS6502_C_API __attribute__((visibility("default")))
+#endif
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+
+// Version of the interface, incremented when it changes in an incompatible way (it is also the SOVERSION)
+#define MOS6502_C_ABI_VERSION 1
+
+// Return codes
+#define MOS6502_C_OK			   0
+#define MOS6502_C_ERROR_ARGUMENT  -1	// Null pointer or invalid argument
+#define MOS6502_C_ERROR_RANGE	  -2	// The memory region goes past 0xFFFF
+#define MOS6502_C_ERROR_MEMORY	  -3	// Allocation failed
+
+// Kinds of events
+#define MOS6502_C_EVENT_RESET	   0	// reset(), pc is the reset vector target
+#define MOS6502_C_EVENT_IRQ		   1	// An IRQ has been taken, pc is the handler
+#define MOS6502_C_EVENT_NMI		   2	// An NMI has been taken, pc is the handler
+#define MOS6502_C_EVENT_HALT	   3	// The CPU has halted, pc is where (see mos6502_c_halted())
+
+// Reasons of a halt, same as mos6502::Halt
+#define MOS6502_C_HALT_NONE			  0	// Running
+#define MOS6502_C_HALT_JAM			  1	// KIL (JAM) opcode, until reset
+#define MOS6502_C_HALT_STOP			  2	// STP (65C02), until reset
+#define MOS6502_C_HALT_JUMP_TO_SELF	  3	// JMP to itself, with halt on loops
+#define MOS6502_C_HALT_BRANCH_TO_SELF 4	// Branch taken to itself, with halt on loops
+
+
+// A machine, created by mos6502_c_create()
+typedef struct mos6502_c_machine mos6502_c_machine;
+
+// Every register, read and written at once
+typedef struct mos6502_c_registers {
+	uint64_t cycles;	// Clock cycles executed
+	uint16_t pc;
+	uint8_t	 a, x, y, p, sp;
+	uint8_t	 reserved;
+} mos6502_c_registers;
+
+// State of the CPU before the execution of an instruction (same fields of TraceRecord)
+typedef struct mos6502_c_trace_record {
+	uint64_t cycle;
+	uint16_t pc;
+	uint8_t	 opcode;
+	uint8_t	 operands[2];	// Only the first length - 1 are meaningful
+	uint8_t	 a, x, y, p, sp;
+	uint8_t	 reserved[6];
+} mos6502_c_trace_record;
+
+// Something that happened during the execution, other than an instruction
+typedef struct mos6502_c_event {
+	uint64_t cycle;		// Cycle of the event
+	uint16_t pc;		// PC after the event
+	uint8_t	 kind;		// MOS6502_C_EVENT_*
+	uint8_t	 reserved[5];
+} mos6502_c_event;
+
+
+// Returns MOS6502_C_ABI_VERSION of the library, to be checked by the bindings when they load it
+MOS6502_C_API uint32_t mos6502_c_abi_version(void);
+
+// Creates a machine with the RAM cleared, returns NULL if the allocation fails
+MOS6502_C_API mos6502_c_machine* mos6502_c_create(void);
+// Destroys a machine (NULL is ignored)
+MOS6502_C_API void mos6502_c_destroy(mos6502_c_machine* machine);
+
+
+/*									 */
+/*			   Execution			 */
+/*									 */
+
+// Runs whole instructions until at least cycles have been executed or the CPU halts, taking the IRQ
+// between instructions while the line is asserted. Returns the number of cycles executed
+MOS6502_C_API uint64_t mos6502_c_run(mos6502_c_machine* machine, uint64_t cycles);
+
+// Returns why the CPU is halted (MOS6502_C_HALT_*), MOS6502_C_HALT_NONE while it runs
+MOS6502_C_API int mos6502_c_halted(const mos6502_c_machine* machine);
+// Halts on the jumps and the branches to themselves (enabled != 0), disabled by default
+MOS6502_C_API int mos6502_c_set_halt_on_loops(mos6502_c_machine* machine, int enabled);
+
+// Brings the CPU to a known state, loading PC from the reset vector (its 7 cycles are run by the next mos6502_c_run())
+MOS6502_C_API int mos6502_c_reset(mos6502_c_machine* machine);
+// Asserts (level != 0) or releases the IRQ line
+MOS6502_C_API int mos6502_c_set_irq(mos6502_c_machine* machine, int level);
+// Takes an NMI before the next instruction
+MOS6502_C_API int mos6502_c_nmi(mos6502_c_machine* machine);
+
+
+/*									 */
+/*		  Registers and memory		 */
+/*									 */
+
+MOS6502_C_API int mos6502_c_get_registers(const mos6502_c_machine* machine, mos6502_c_registers* registers);
+MOS6502_C_API int mos6502_c_set_registers(mos6502_c_machine* machine, const mos6502_c_registers* registers);
+
+// Copies size bytes from data into the RAM at address, or from the RAM at address into data.
+// The region must end at 0xFFFF at most, size 0 is allowed
+MOS6502_C_API int mos6502_c_load(mos6502_c_machine* machine, uint16_t address, const uint8_t* data, size_t size);
+MOS6502_C_API int mos6502_c_dump(const mos6502_c_machine* machine, uint16_t address, uint8_t* data, size_t size);
+
+
+/*									 */
+/*		   Trace and events			 */
+/*									 */
+
+// Records the state of the CPU before every instruction in a buffer of capacity records (0 disables the trace).
+// When the buffer is full the oldest records are dropped. Pending records are discarded
+MOS6502_C_API int mos6502_c_trace_enable(mos6502_c_machine* machine, size_t capacity);
+// Moves up to count of the oldest pending records into records, returns the number moved
+MOS6502_C_API size_t mos6502_c_trace_drain(mos6502_c_machine* machine, mos6502_c_trace_record* records, size_t count);
+
+// Same as above for the events, recorded in a buffer of 1024 events by default (0 disables them)
+MOS6502_C_API int mos6502_c_events_enable(mos6502_c_machine* machine, size_t capacity);
+MOS6502_C_API size_t mos6502_c_events_drain(mos6502_c_machine* machine, mos6502_c_event* events, size_t count);
+
+// Number of trace records and events dropped because their buffer was full
+MOS6502_C_API uint64_t mos6502_c_trace_dropped(const mos6502_c_machine* machine);
+MOS6502_C_API uint64_t mos6502_c_events_dropped(const mos6502_c_machine* machine);
+
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
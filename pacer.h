@@ -0,0 +1,112 @@
+#pragma once
+
+///
+/// Real-time pacing of the emulation to a fixed frequency (POSIX clock_nanosleep, library mos6502_pacer)
+///
+
+#include <cstdint>
+#include <array>
+#include <chrono>
+
+#include "mos6502.h"
+
+
+// Keeps mos6502::clock_count in step with the wall clock: the CPU runs in bursts, after each burst the
+// pacer sleeps with clock_nanosleep(TIMER_ABSTIME) until the time of the cycle reached. Deadlines are
+// computed from the cycle and the time of start(), so they don't drift however long the emulation runs
+// and late bursts are caught up by the next ones
+class Pacer
+{
+public:
+
+	struct Options {
+		// Cycles per burst, 0: one millisecond of emulated time
+		uint64_t burst = 0;
+		// Spins instead of sleeping the last part of the wait before a deadline, trading CPU time
+		// for lower jitter (0: always sleep)
+		std::chrono::nanoseconds spin{ 0 };
+		// A burst this late restarts the timebase from it instead of being caught up by running faster
+		// than real time (a debugger pause, the host suspended)
+		std::chrono::nanoseconds max_lateness = std::chrono::milliseconds{ 50 };
+	};
+
+	// Lateness of the bursts: how late the emulation was with respect to the deadline of a burst when
+	// the next one started (after the sleep, or at once if the burst ended after its deadline)
+	struct Statistics {
+		uint64_t bursts	  = 0;	// Deadlines waited for
+		uint64_t overruns = 0;	// Bursts that ended after their deadline (no sleep)
+		uint64_t resyncs  = 0;	// Timebase restarts after a burst later than max_lateness
+		std::chrono::nanoseconds max_lateness{ 0 };
+		std::chrono::nanoseconds total_lateness{ 0 };
+		// Bursts by lateness: < 1 us, < 10 us, < 100 us, < 1 ms, >= 1 ms
+		std::array<uint64_t, 5> histogram{ };
+
+		std::chrono::nanoseconds meanLateness() const { return bursts ? total_lateness / static_cast<int64_t>(bursts) : std::chrono::nanoseconds{ 0 }; }
+
+		// Clears every counter
+		void reset() { *this = Statistics{ }; }
+	};
+
+	// Paces the emulation at frequency Hz (1789773.0 for a NES), throws std::invalid_argument if it isn't positive
+	explicit Pacer(double frequency, Options options);
+	explicit Pacer(double frequency) : Pacer(frequency, Options{ }) { }
+
+	// Makes cycle the current time of the timebase, run() calls it the first time
+	void start(uint64_t cycle);
+
+	// Sleeps until the time of cycle (returns at once if it's passed), updating the statistics
+	void wait(uint64_t cycle);
+
+	// Runs the CPU with step() for at least cycles, in bursts paced to the wall clock. Returns at once
+	// when the CPU halts (mos6502::halted())
+	void run(mos6502& cpu, uint64_t cycles);
+	// Same as above, calling hooks around every instruction
+	template <typename Hooks>
+	void run(mos6502& cpu, uint64_t cycles, Hooks& hooks);
+
+	const Statistics& statistics() const { return stats; }
+	Statistics& statistics() { return stats; }
+
+private:
+	// Time of cycle, in nanoseconds of CLOCK_MONOTONIC
+	int64_t deadline(uint64_t cycle) const;
+	// Current time, in nanoseconds of CLOCK_MONOTONIC
+	static int64_t now();
+	// Adds the lateness of a burst to the statistics
+	void record(int64_t lateness);
+
+private:
+	Options options;
+	// Nanoseconds per cycle
+	double period;
+
+	bool	 started = false;
+	int64_t	 epoch	 = 0;	// Time of base
+	uint64_t base	 = 0;	// Cycle of epoch
+
+	Statistics stats;
+};
+
+
+template <typename Hooks>
+void Pacer::run(mos6502& cpu, uint64_t cycles, Hooks& hooks)
+{
+	if (!started)
+		start(cpu.clock_count);
+
+	uint64_t end = cpu.clock_count + cycles;
+
+	while (cpu.clock_count < end)
+	{
+		uint64_t target = cpu.clock_count + options.burst;
+
+		while (cpu.clock_count < target && cpu.clock_count < end)
+		{
+			if (cpu.step(hooks) == 0)
+				return;
+		}
+
+		// The last instruction can end past the burst, its deadline is the one of the cycle reached
+		wait(cpu.clock_count);
+	}
+}
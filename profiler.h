@@ -0,0 +1,125 @@
+#pragma once
+
+///
+/// Hot spot and call graph profiler of emulated code
+///
+
+#include <cstdint>
+#include <ostream>
+#include <unordered_map>
+#include <vector>
+
+#include "mos6502.h"
+#include "symbols.h"
+
+
+// Attributes cycles to addresses and, following JSR/RTS, interrupts and RTI, to routines.
+// Counters are flat arrays indexed by address, routines and call tree are only updated by calls and returns
+class Profiler
+{
+public:
+
+	// Profile of a routine (JSR target or interrupt handler)
+	struct Routine {
+		uint16_t address;	// Entry point
+		uint64_t calls;		// Number of times it has been entered
+		uint64_t inclusive;	// Cycles spent in it and in the routines it called (recursion counted once)
+		uint64_t exclusive;	// Cycles spent in its own instructions
+	};
+
+	// Calls deeper than this are attributed to the deepest node of the call tree
+	static constexpr std::size_t max_tree_depth = 256;
+
+	Profiler();
+
+	// Executes an instruction with mos6502::step() and records it
+	// Use ProfilerHooks to profile the interrupts too, or together with other hooks
+	uint8_t step(mos6502& cpu);
+
+	// Records an instruction at pc that took cycles, next_pc is the PC after its execution
+	void instruction(uint16_t pc, uint8_t opcode, uint8_t cycles, uint16_t next_pc);
+
+	// Records the entry in an interrupt handler, cycles are the ones of the interrupt sequence
+	void interrupt(uint16_t handler, uint8_t cycles);
+
+	// Clears every counter
+	void reset();
+
+	// Cycles spent by the instructions at every address
+	const std::vector<uint64_t>& addressCycles() const;
+
+	// Total number of cycles recorded
+	uint64_t totalCycles() const;
+
+	// Every routine entered at least once, by exclusive cycles (descending)
+	std::vector<Routine> routines() const;
+
+	// Writes the call stacks in the flamegraph "folded" format (frame;frame;frame cycles)
+	void writeFolded(std::ostream& out, const SymbolTable* symbols = nullptr) const;
+
+	// Writes a human readable report of the hottest addresses and routines
+	void writeReport(std::ostream& out, const SymbolTable* symbols = nullptr, std::size_t top = 20) const;
+
+private:
+
+	// A node of the call tree: a routine reached through a particular stack
+	struct Node {
+		uint32_t parent;
+		uint16_t routine;
+		uint64_t cycles = 0;	// Exclusive cycles spent with this stack
+	};
+
+	// An active call
+	struct Frame {
+		uint16_t routine;
+		uint32_t node;
+		uint64_t start;		// totalCycles() when entered
+	};
+
+	// Attributes the cycles recorded since the last call to the current routine
+	void flush();
+	// Enters a routine, cycles are attributed to it
+	void enter(uint16_t routine, uint8_t cycles);
+	// Leaves the current routine
+	void leave();
+
+private:
+
+	// Flat counters, indexed by address
+	std::vector<uint64_t> address_cycles;
+	std::vector<uint64_t> exclusive;
+	std::vector<uint64_t> inclusive;
+	std::vector<uint64_t> calls;
+	// Number of active frames of each routine, to count recursion once
+	std::vector<uint32_t> active;
+
+	std::vector<Frame> stack;
+	std::vector<Node> tree;
+	// Child nodes, by (parent << 16 | routine)
+	std::unordered_map<uint64_t, uint32_t> children;
+
+	uint64_t total = 0;
+	// Value of total when the cycles have been attributed to the current routine
+	uint64_t mark = 0;
+};
+
+
+// Hooks that record every instruction and interrupt in a profiler
+class ProfilerHooks : public NoHooks
+{
+public:
+	explicit ProfilerHooks(Profiler& profiler)
+		: profiler{ profiler }
+	{ }
+
+	void afterInstruction(const mos6502& cpu, uint16_t pc, uint8_t opcode, uint8_t cycles)
+	{
+		profiler.instruction(pc, opcode, cycles, cpu.PC);
+	}
+
+	// The interrupt sequence takes 7 cycles
+	void interrupt(const mos6502& cpu, [[maybe_unused]] uint16_t vector) { profiler.interrupt(cpu.PC, 7); }
+
+private:
+	Profiler& profiler;
+};
@@ -0,0 +1,437 @@
+///
+/// Implementation of the recursive traversal analyzer
+///
+
+#include <cstdint>
+#include <algorithm>
+
+#include "../analyzer.h"
+
+
+CodeAnalyzer::Flow CodeAnalyzer::flowOf(const mos6502::Disassembly& record)
+{
+#ifdef CMOS_65C02
+	switch (record.opcode)
+	{
+	case 0x80: return Flow::Jump;			// BRA
+	case 0x7C: return Flow::JumpIndirect;	// JMP (abs,X)
+	case 0xDB: return Flow::Stop;			// STP
+	}
+
+	if (record.mode == mos6502::AddressMode::ZPR)
+		return Flow::Branch;
+#endif
+
+	if (record.mode == mos6502::AddressMode::REL)
+		return Flow::Branch;
+
+	switch (record.opcode)
+	{
+	case 0x4C: return Flow::Jump;
+	case 0x6C: return Flow::JumpIndirect;
+	case 0x20: return Flow::Call;
+	case 0x00:
+	case 0x40:
+	case 0x60: return Flow::Stop;
+	}
+
+	if (mos6502::mnemonic(record.opcode) == "KIL")
+		return Flow::Stop;
+
+	return Flow::Next;
+}
+
+
+uint16_t CodeAnalyzer::operandWord(const mos6502::Disassembly& record)
+{
+	return (static_cast<uint16_t>(record.operands[1]) << 8) | record.operands[0];
+}
+
+
+uint16_t CodeAnalyzer::branchTarget(const mos6502::Disassembly& record)
+{
+	// BBR and BBS have the offset after the zero page address
+	uint8_t offset = record.mode == mos6502::AddressMode::ZPR ? record.operands[1] : record.operands[0];
+
+	return static_cast<uint16_t>(record.address + record.length + static_cast<int8_t>(offset));
+}
+
+
+uint16_t CodeAnalyzer::jumpTarget(const mos6502::Disassembly& record)
+{
+	// BRA is a relative jump
+	return record.mode == mos6502::AddressMode::REL ? branchTarget(record) : operandWord(record);
+}
+
+
+// Address of the high byte of the target of JMP (pointer), with the same page wrapping bug as mos6502::IND
+static uint16_t highPointer(uint16_t pointer)
+{
+#ifdef CMOS_65C02
+	return static_cast<uint16_t>(pointer + 1);
+#else
+	return (pointer & 0xFF00) | ((pointer + 1) & 0x00FF);
+#endif
+}
+
+
+static uint16_t readWord(std::span<const uint8_t, 0x10000> memory, uint16_t address)
+{
+	return (static_cast<uint16_t>(memory[static_cast<uint16_t>(address + 1)]) << 8) | memory[address];
+}
+
+
+CodeAnalyzer::CodeAnalyzer()
+	: result{ std::make_unique<Analysis>() },
+	  snapshot{ std::make_unique<std::array<uint8_t, 0x10000>>() }
+{ }
+
+
+void CodeAnalyzer::addEntryPoint(uint16_t address)
+{
+	entry_points.push_back(address);
+	valid = false;
+}
+
+
+void CodeAnalyzer::invalidate()
+{
+	valid = false;
+}
+
+
+bool CodeAnalyzer::reused() const
+{
+	return last_reused;
+}
+
+
+const CodeAnalyzer::Analysis& CodeAnalyzer::analyze(std::span<const uint8_t, 0x10000> memory)
+{
+	last_reused = valid && update(memory);
+
+	if (last_reused)
+		return *result;
+
+	traverse(memory);
+	buildBlocks(memory);
+	buildCallGraph(memory);
+
+	// Only the bytes the result depends on are kept and compared by the next calls
+	dependencies.clear();
+	for (uint32_t address = 0; address < 0x10000; ++address)
+	{
+		if (result->map[address] == ByteType::Unknown)
+			continue;
+
+		dependencies.push_back(static_cast<uint16_t>(address));
+		(*snapshot)[address] = memory[address];
+	}
+
+	valid = true;
+
+	return *result;
+}
+
+
+bool CodeAnalyzer::update(std::span<const uint8_t, 0x10000> memory)
+{
+	for (uint16_t address : dependencies)
+	{
+		if ((*snapshot)[address] == memory[address])
+			continue;
+
+		if (!neutral(memory, address))
+			return false;
+
+		(*snapshot)[address] = memory[address];
+	}
+
+	return true;
+}
+
+
+bool CodeAnalyzer::neutral(std::span<const uint8_t, 0x10000> memory, uint16_t address) const
+{
+	bool covered = false;
+
+	// The instructions the byte belongs to: its own and, with overlapping code, up to two before it
+	for (uint16_t back = 0; back < 3; ++back)
+	{
+		uint16_t start = static_cast<uint16_t>(address - back);
+		if (result->map[start] != ByteType::Opcode)
+			continue;
+
+		mos6502::Disassembly before = mos6502::decode(*snapshot, start);
+		if (before.length <= back)
+			continue;
+
+		covered = true;
+		if (flowOf(before) != Flow::Next)
+			return false;
+
+		// A new opcode must keep the length and the flow
+		if (back == 0)
+		{
+			mos6502::Disassembly after = mos6502::decode(memory, start);
+			if (after.length != before.length || flowOf(after) != Flow::Next)
+				return false;
+		}
+	}
+
+	// Vectors and indirect jump pointers
+	return covered;
+}
+
+
+void CodeAnalyzer::traverse(std::span<const uint8_t, 0x10000> memory)
+{
+	Analysis& analysis = *result;
+
+	analysis.map.fill(ByteType::Unknown);
+	analysis.blocks.clear();
+	analysis.routines.clear();
+	analysis.calls.clear();
+	analysis.conflicts.clear();
+
+	leaders.assign(0x10000, false);
+
+	std::vector<uint16_t> worklist;
+
+	// Marks an address as the start of a flow to follow
+	auto addTarget = [&](uint16_t address) {
+		leaders[address] = true;
+		worklist.push_back(address);
+	};
+
+	// Marks the bytes read as data by the control flow
+	auto markData = [&](uint16_t address, uint16_t length) {
+		for (uint16_t i = 0; i < length; ++i)
+			if (analysis.map[static_cast<uint16_t>(address + i)] == ByteType::Unknown)
+				analysis.map[static_cast<uint16_t>(address + i)] = ByteType::Data;
+	};
+
+	for (uint16_t vector : { nmi_vector, reset_vector, irq_vector })
+	{
+		uint16_t target = readWord(memory, vector);
+
+		markData(vector, 2);
+		addTarget(target);
+		analysis.routines.push_back(target);
+	}
+
+	for (uint16_t entry : entry_points)
+	{
+		addTarget(entry);
+		analysis.routines.push_back(entry);
+	}
+
+	while (!worklist.empty())
+	{
+		uint16_t address = worklist.back();
+		worklist.pop_back();
+
+		// Follows the flow linearly until it stops or reaches known code
+		for (bool follow = true; follow; )
+		{
+			if (analysis.map[address] == ByteType::Opcode)
+				break;
+
+			if (analysis.map[address] != ByteType::Unknown)
+			{
+				analysis.conflicts.push_back(address);
+				break;
+			}
+
+			mos6502::Disassembly record = mos6502::decode(memory, address);
+
+			analysis.map[address] = ByteType::Opcode;
+			for (uint16_t i = 1; i < record.length; ++i)
+			{
+				auto& type = analysis.map[static_cast<uint16_t>(address + i)];
+
+				if (type == ByteType::Opcode)
+					analysis.conflicts.push_back(static_cast<uint16_t>(address + i));
+				else
+					type = ByteType::Operand;
+			}
+
+			uint16_t next = static_cast<uint16_t>(address + record.length);
+
+			switch (flowOf(record))
+			{
+			case Flow::Next:
+				address = next;
+				break;
+
+			case Flow::Branch:
+				addTarget(branchTarget(record));
+				leaders[next] = true;
+				address = next;
+				break;
+
+			case Flow::Jump:
+				addTarget(jumpTarget(record));
+				follow = false;
+				break;
+
+			case Flow::JumpIndirect:
+			{
+				// The target of JMP (abs,X) depends on X
+				if (record.mode != mos6502::AddressMode::IND)
+				{
+					follow = false;
+					break;
+				}
+
+				uint16_t pointer = operandWord(record);
+				uint16_t hi_pointer = highPointer(pointer);
+
+				markData(pointer, 1);
+				markData(hi_pointer, 1);
+				addTarget((static_cast<uint16_t>(memory[hi_pointer]) << 8) | memory[pointer]);
+				follow = false;
+				break;
+			}
+
+			case Flow::Call:
+				addTarget(operandWord(record));
+				analysis.routines.push_back(operandWord(record));
+				address = next;
+				break;
+
+			case Flow::Stop:
+				follow = false;
+				break;
+			}
+		}
+	}
+
+	std::sort(analysis.routines.begin(), analysis.routines.end());
+	analysis.routines.erase(std::unique(analysis.routines.begin(), analysis.routines.end()), analysis.routines.end());
+
+	std::sort(analysis.conflicts.begin(), analysis.conflicts.end());
+	analysis.conflicts.erase(std::unique(analysis.conflicts.begin(), analysis.conflicts.end()), analysis.conflicts.end());
+}
+
+
+void CodeAnalyzer::buildBlocks(std::span<const uint8_t, 0x10000> memory)
+{
+	Analysis& analysis = *result;
+
+	for (uint32_t start = 0; start < 0x10000; ++start)
+	{
+		if (!leaders[start] || analysis.map[start] != ByteType::Opcode)
+			continue;
+
+		BasicBlock block{ };
+		block.start = static_cast<uint16_t>(start);
+
+		uint16_t address = block.start;
+
+		// A block can't be longer than the memory, the bound avoids looping on wrapping code
+		for (uint32_t steps = 0; steps < 0x10000; ++steps)
+		{
+			mos6502::Disassembly record = mos6502::decode(memory, address);
+			uint16_t next = static_cast<uint16_t>(address + record.length);
+
+			block.last = address;
+
+			Flow flow = flowOf(record);
+
+			if (flow == Flow::Branch)
+			{
+				block.successors[block.successor_count++] = branchTarget(record);
+				block.successors[block.successor_count++] = next;
+				break;
+			}
+			if (flow == Flow::Jump)
+			{
+				block.successors[block.successor_count++] = jumpTarget(record);
+				break;
+			}
+			if (flow == Flow::JumpIndirect)
+			{
+				uint16_t pointer = operandWord(record);
+
+				if (record.mode == mos6502::AddressMode::IND)
+					block.successors[block.successor_count++] = (static_cast<uint16_t>(memory[highPointer(pointer)]) << 8) | memory[pointer];
+				break;
+			}
+			if (flow == Flow::Stop)
+				break;
+
+			// The next instruction starts another block (or it's not code at all)
+			if (leaders[next] || analysis.map[next] != ByteType::Opcode)
+			{
+				if (analysis.map[next] == ByteType::Opcode)
+					block.successors[block.successor_count++] = next;
+				break;
+			}
+
+			address = next;
+		}
+
+		analysis.blocks.push_back(block);
+	}
+}
+
+
+void CodeAnalyzer::buildCallGraph(std::span<const uint8_t, 0x10000> memory)
+{
+	Analysis& analysis = *result;
+
+	// Index of the block starting at an address
+	auto findBlock = [&](uint16_t address) -> const BasicBlock* {
+		auto it = std::lower_bound(analysis.blocks.begin(), analysis.blocks.end(), address,
+			[](const BasicBlock& block, uint16_t address) { return block.start < address; });
+
+		if (it == analysis.blocks.end() || it->start != address)
+			return nullptr;
+		return &*it;
+	};
+
+	// Visit marks, tagged with the routine being walked to avoid clearing them
+	std::vector<std::size_t> visited(analysis.blocks.size(), 0);
+	std::vector<const BasicBlock*> stack;
+
+	for (std::size_t r = 0; r < analysis.routines.size(); ++r)
+	{
+		uint16_t routine = analysis.routines[r];
+
+		if (const BasicBlock* first = findBlock(routine))
+			stack.push_back(first);
+
+		while (!stack.empty())
+		{
+			const BasicBlock* block = stack.back();
+			stack.pop_back();
+
+			std::size_t index = block - analysis.blocks.data();
+			if (visited[index] == r + 1)
+				continue;
+			visited[index] = r + 1;
+
+			for (uint32_t address = block->start; address <= block->last; )
+			{
+				mos6502::Disassembly record = mos6502::decode(memory, static_cast<uint16_t>(address));
+
+				if (flowOf(record) == Flow::Call)
+					analysis.calls.push_back({ routine, record.address, operandWord(record) });
+
+				address += record.length;
+			}
+
+			for (uint8_t i = 0; i < block->successor_count; ++i)
+				if (const BasicBlock* successor = findBlock(block->successors[i]))
+					stack.push_back(successor);
+		}
+	}
+
+	std::sort(analysis.calls.begin(), analysis.calls.end(), [](const Call& a, const Call& b) {
+		return a.caller != b.caller ? a.caller < b.caller : a.site < b.site;
+	});
+	analysis.calls.erase(std::unique(analysis.calls.begin(), analysis.calls.end(), [](const Call& a, const Call& b) {
+		return a.caller == b.caller && a.site == b.site;
+	}), analysis.calls.end());
+}
@@ -0,0 +1,155 @@
+///
+/// Implementation of BatchDisassembler
+///
+
+#include <cstdint>
+#include <algorithm>
+#include <cerrno>
+#include <cstdio>
+#include <cstring>
+#include <array>
+#include <atomic>
+#include <exception>
+#include <memory>
+#include <mutex>
+#include <thread>
+
+#include "../batch.h"
+#include "../mos6502.h"
+
+
+BatchDisassembler::BatchDisassembler(unsigned threads)
+	: threads{ threads ? threads : std::max(1u, std::thread::hardware_concurrency()) }
+{ }
+
+
+// Writes value as hex digits at the end of line
+static void appendHex(std::string& line, unsigned value, int digits)
+{
+	static constexpr char hex_digits[] = "0123456789ABCDEF";
+
+	for (int shift = (digits - 1) * 4; shift >= 0; shift -= 4)
+		line.push_back(hex_digits[(value >> shift) & 0x0F]);
+}
+
+
+void BatchDisassembler::disassemble(const Image& image, Result& result)
+{
+	// Every thread works on its own copy of the memory
+	thread_local std::unique_ptr<std::array<uint8_t, 0x10000>> memory = std::make_unique<std::array<uint8_t, 0x10000>>();
+
+	std::size_t size = std::min<std::size_t>(image.bytes.size(), 0x10000);
+
+	// The image is mapped at its load address, wrapping around at the end of memory
+	std::size_t first = std::min<std::size_t>(size, 0x10000 - image.load_address);
+	memory->fill(0x00);
+	std::memcpy(memory->data() + image.load_address, image.bytes.data(), first);
+	std::memcpy(memory->data(), image.bytes.data() + first, size - first);
+
+	// Closed on an exception, the normal path closes it itself to check for write errors
+	std::unique_ptr<std::FILE, decltype(&std::fclose)> file{ nullptr, &std::fclose };
+	if (!image.output_path.empty())
+	{
+		file.reset(std::fopen(image.output_path.c_str(), "w"));
+		if (!file)
+		{
+			result.error = "Can't open " + image.output_path + ": " + std::strerror(errno);
+			return;
+		}
+	}
+
+	// A listing line is about 28 characters long and an instruction about 2 bytes long, so the listing is
+	// about 14 times the image. A file is written through a 64 KB buffer instead
+	std::string& text = result.text;
+	text.clear();
+	text.reserve(file ? 64 * 1024 : size * 14);
+
+	char instruction[mos6502::max_format_length];
+
+	for (std::size_t offset = 0; offset < size; )
+	{
+		auto record = mos6502::decode(*memory, static_cast<uint16_t>(image.load_address + offset));
+
+		// Format: AAAA  OP B1 B2  INSTRUCTION
+		appendHex(text, record.address, 4);
+		text.append("  ");
+		appendHex(text, record.opcode, 2);
+		for (uint8_t i = 0; i < 2; ++i)
+		{
+			text.push_back(' ');
+			if (i + 1 < record.length)
+				appendHex(text, record.operands[i], 2);
+			else
+				text.append("  ");
+		}
+		text.append("  ");
+		text.append(instruction, mos6502::format(record, instruction));
+		text.push_back('\n');
+
+		offset += record.length;
+		++result.instructions;
+
+		// Streams the listing into the file in big chunks
+		if (file && text.size() >= 60 * 1024)
+		{
+			if (std::fwrite(text.data(), 1, text.size(), file.get()) != text.size())
+				break;
+			text.clear();
+		}
+	}
+
+	if (file)
+	{
+		// A short write (disk full) leaves the error flag of the stream set
+		bool written = std::fwrite(text.data(), 1, text.size(), file.get()) == text.size() && !std::ferror(file.get());
+		text.clear();
+
+		if (std::fclose(file.release()) != 0 || !written)
+			result.error = "Can't write " + image.output_path + ": " + std::strerror(errno);
+	}
+}
+
+
+std::vector<BatchDisassembler::Result> BatchDisassembler::run(std::span<const Image> images) const
+{
+	std::vector<Result> results(images.size());
+
+	// Images are handed out one at a time, so big and small ones balance between threads
+	std::atomic<std::size_t> next{ 0 };
+
+	// The first exception of a thread stops the others, it's thrown after they've joined
+	std::exception_ptr failure;
+	std::mutex failure_mutex;
+
+	auto worker = [&] {
+		try
+		{
+			for (std::size_t i = next++; i < images.size(); i = next++)
+				disassemble(images[i], results[i]);
+		}
+		catch (...)
+		{
+			std::lock_guard lock{ failure_mutex };
+			if (!failure)
+				failure = std::current_exception();
+			next = images.size();
+		}
+	};
+
+	std::vector<std::thread> pool;
+	unsigned count = std::min<std::size_t>(threads, images.size());
+
+	for (unsigned i = 1; i < count; ++i)
+		pool.emplace_back(worker);
+
+	// The calling thread works too
+	worker();
+
+	for (auto& thread : pool)
+		thread.join();
+
+	if (failure)
+		std::rethrow_exception(failure);
+
+	return results;
+}
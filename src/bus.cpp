@@ -1,26 +1,121 @@
-///
-/// Definitions of write() and read()
-///
-
-
-#include <cstdint>
-
-#include "../bus.h"
-
-
-void Bus::write(uint16_t address, uint8_t data)
-{
-    if (address >= 0x0000 && address <= 0xFFFF)
-        ram[address] = data;
-}
-
-
-uint8_t Bus::read(uint16_t address, bool readonly)
-{
-    if (address >= 0x0000 && address <= 0xFFFF) 
-    {
-        return ram[address];
-    }
-
-    return 0;
-}
+///
+/// Definitions of write() and read(), catch-up of the devices
+///
+
+
+#include <cstdint>
+#include <algorithm>
+
+#include "../bus.h"
+#include "../mos6502.h"
+
+
+void Bus::write(uint16_t address, uint8_t data)
+{
+    if (Device* device = pages[address >> 8])
+    {
+        catchUp(*device, now());
+        device->write(address, data);
+        schedule();
+        return;
+    }
+
+    ram[address] = data;
+}
+
+
+uint8_t Bus::read(uint16_t address, bool readonly)
+{
+    if (Device* device = pages[address >> 8])
+    {
+        if (readonly)
+            return device->peek(address);
+
+        catchUp(*device, now());
+        uint8_t data = device->read(address);
+        schedule();
+        return data;
+    }
+
+    return ram[address];
+}
+
+
+void Bus::map(Device& device, uint8_t first_page, uint8_t last_page)
+{
+    // The device starts from the current cycle
+    if (std::find(devices.begin(), devices.end(), &device) == devices.end())
+    {
+        device.synced = now();
+        devices.push_back(&device);
+    }
+
+    for (unsigned page = first_page; page <= last_page; ++page)
+        pages[page] = &device;
+
+    // The device can replace another one
+    collect();
+}
+
+
+void Bus::unmap(uint8_t first_page, uint8_t last_page)
+{
+    for (unsigned page = first_page; page <= last_page; ++page)
+        pages[page] = nullptr;
+
+    collect();
+}
+
+
+void Bus::update(uint64_t cycle)
+{
+    for (Device* device : devices)
+        if (device->deadline() <= cycle)
+            catchUp(*device, cycle);
+
+    schedule();
+}
+
+
+void Bus::sync(uint64_t cycle)
+{
+    for (Device* device : devices)
+        catchUp(*device, cycle);
+
+    schedule();
+}
+
+
+uint64_t Bus::now() const
+{
+    return cpu ? cpu->clock_count : 0;
+}
+
+
+void Bus::catchUp(Device& device, uint64_t cycle)
+{
+    if (cycle > device.synced)
+    {
+        device.run(cycle - device.synced);
+        device.synced = cycle;
+    }
+}
+
+
+void Bus::collect()
+{
+    std::erase_if(devices, [this](Device* device) {
+        return std::find(pages.begin(), pages.end(), device) == pages.end();
+    });
+
+    schedule();
+}
+
+
+void Bus::schedule()
+{
+    next_deadline = Device::never;
+
+    for (const Device* device : devices)
+        next_deadline = std::min(next_deadline, device->deadline());
+}
@@ -0,0 +1,248 @@
+///
+/// Implementation of the WDC 65C02 variant: opcodes lookup array and CMOS instructions,
+/// compiled only when CMOS_65C02 is defined
+///
+
+#include <cstdint>
+
+#include "../mos6502.h"
+
+#ifdef CMOS_65C02
+
+
+// Filling the opcodes lookup array: undefined opcodes are NOPs of 1 to 3 bytes
+constinit const std::array<mos6502::Instruction, 256> mos6502::lookup {
+/* 0 */{{ Operation::BRK, AddressMode::IMP, 7 }, { Operation::ORA, AddressMode::IXD, 6 }, { Operation::NOP, AddressMode::IMM, 2 }, { Operation::NOP, AddressMode::IMP, 1 }, { Operation::TSB, AddressMode::ZP0, 5 }, { Operation::ORA, AddressMode::ZP0, 3 }, { Operation::ASL, AddressMode::ZP0, 5 }, { Operation::RMB, AddressMode::ZP0, 5 }, { Operation::PHP, AddressMode::IMP, 3 }, { Operation::ORA, AddressMode::IMM, 2 }, { Operation::ASL, AddressMode::ACC, 2 }, { Operation::NOP, AddressMode::IMP, 1 }, { Operation::TSB, AddressMode::ABS, 6 }, { Operation::ORA, AddressMode::ABS, 4 }, { Operation::ASL, AddressMode::ABS, 6 }, { Operation::BBR, AddressMode::ZPR, 5 },
+/* 1 */	{ Operation::BPL, AddressMode::REL, 2 }, { Operation::ORA, AddressMode::IYD, 5 }, { Operation::ORA, AddressMode::ZPI, 5 }, { Operation::NOP, AddressMode::IMP, 1 }, { Operation::TRB, AddressMode::ZP0, 5 }, { Operation::ORA, AddressMode::ZPX, 4 }, { Operation::ASL, AddressMode::ZPX, 6 }, { Operation::RMB, AddressMode::ZP0, 5 }, { Operation::CLC, AddressMode::IMP, 2 }, { Operation::ORA, AddressMode::ABY, 4 }, { Operation::INC, AddressMode::ACC, 2 }, { Operation::NOP, AddressMode::IMP, 1 }, { Operation::TRB, AddressMode::ABS, 6 }, { Operation::ORA, AddressMode::ABX, 4 }, { Operation::ASL, AddressMode::ABX, 6 }, { Operation::BBR, AddressMode::ZPR, 5 },
+/* 2 */	{ Operation::JSR, AddressMode::ABS, 6 }, { Operation::AND, AddressMode::IXD, 6 }, { Operation::NOP, AddressMode::IMM, 2 }, { Operation::NOP, AddressMode::IMP, 1 }, { Operation::BIT, AddressMode::ZP0, 3 }, { Operation::AND, AddressMode::ZP0, 3 }, { Operation::ROL, AddressMode::ZP0, 5 }, { Operation::RMB, AddressMode::ZP0, 5 }, { Operation::PLP, AddressMode::IMP, 4 }, { Operation::AND, AddressMode::IMM, 2 }, { Operation::ROL, AddressMode::ACC, 2 }, { Operation::NOP, AddressMode::IMP, 1 }, { Operation::BIT, AddressMode::ABS, 4 }, { Operation::AND, AddressMode::ABS, 4 }, { Operation::ROL, AddressMode::ABS, 6 }, { Operation::BBR, AddressMode::ZPR, 5 },
+/* 3 */	{ Operation::BMI, AddressMode::REL, 2 }, { Operation::AND, AddressMode::IYD, 5 }, { Operation::AND, AddressMode::ZPI, 5 }, { Operation::NOP, AddressMode::IMP, 1 }, { Operation::BIT, AddressMode::ZPX, 4 }, { Operation::AND, AddressMode::ZPX, 4 }, { Operation::ROL, AddressMode::ZPX, 6 }, { Operation::RMB, AddressMode::ZP0, 5 }, { Operation::SEC, AddressMode::IMP, 2 }, { Operation::AND, AddressMode::ABY, 4 }, { Operation::DEC, AddressMode::ACC, 2 }, { Operation::NOP, AddressMode::IMP, 1 }, { Operation::BIT, AddressMode::ABX, 4 }, { Operation::AND, AddressMode::ABX, 4 }, { Operation::ROL, AddressMode::ABX, 6 }, { Operation::BBR, AddressMode::ZPR, 5 },
+/* 4 */	{ Operation::RTI, AddressMode::IMP, 6 }, { Operation::EOR, AddressMode::IXD, 6 }, { Operation::NOP, AddressMode::IMM, 2 }, { Operation::NOP, AddressMode::IMP, 1 }, { Operation::NOP, AddressMode::ZP0, 3 }, { Operation::EOR, AddressMode::ZP0, 3 }, { Operation::LSR, AddressMode::ZP0, 5 }, { Operation::RMB, AddressMode::ZP0, 5 }, { Operation::PHA, AddressMode::IMP, 3 }, { Operation::EOR, AddressMode::IMM, 2 }, { Operation::LSR, AddressMode::ACC, 2 }, { Operation::NOP, AddressMode::IMP, 1 }, { Operation::JMP, AddressMode::ABS, 3 }, { Operation::EOR, AddressMode::ABS, 4 }, { Operation::LSR, AddressMode::ABS, 6 }, { Operation::BBR, AddressMode::ZPR, 5 },
+/* 5 */	{ Operation::BVC, AddressMode::REL, 2 }, { Operation::EOR, AddressMode::IYD, 5 }, { Operation::EOR, AddressMode::ZPI, 5 }, { Operation::NOP, AddressMode::IMP, 1 }, { Operation::NOP, AddressMode::ZPX, 4 }, { Operation::EOR, AddressMode::ZPX, 4 }, { Operation::LSR, AddressMode::ZPX, 6 }, { Operation::RMB, AddressMode::ZP0, 5 }, { Operation::CLI, AddressMode::IMP, 2 }, { Operation::EOR, AddressMode::ABY, 4 }, { Operation::PHY, AddressMode::IMP, 3 }, { Operation::NOP, AddressMode::IMP, 1 }, { Operation::NOP, AddressMode::ABS, 8 }, { Operation::EOR, AddressMode::ABX, 4 }, { Operation::LSR, AddressMode::ABX, 6 }, { Operation::BBR, AddressMode::ZPR, 5 },
+/* 6 */	{ Operation::RTS, AddressMode::IMP, 6 }, { Operation::ADC, AddressMode::IXD, 6 }, { Operation::NOP, AddressMode::IMM, 2 }, { Operation::NOP, AddressMode::IMP, 1 }, { Operation::STZ, AddressMode::ZP0, 3 }, { Operation::ADC, AddressMode::ZP0, 3 }, { Operation::ROR, AddressMode::ZP0, 5 }, { Operation::RMB, AddressMode::ZP0, 5 }, { Operation::PLA, AddressMode::IMP, 4 }, { Operation::ADC, AddressMode::IMM, 2 }, { Operation::ROR, AddressMode::ACC, 2 }, { Operation::NOP, AddressMode::IMP, 1 }, { Operation::JMP, AddressMode::IND, 6 }, { Operation::ADC, AddressMode::ABS, 4 }, { Operation::ROR, AddressMode::ABS, 6 }, { Operation::BBR, AddressMode::ZPR, 5 },
+/* 7 */	{ Operation::BVS, AddressMode::REL, 2 }, { Operation::ADC, AddressMode::IYD, 5 }, { Operation::ADC, AddressMode::ZPI, 5 }, { Operation::NOP, AddressMode::IMP, 1 }, { Operation::STZ, AddressMode::ZPX, 4 }, { Operation::ADC, AddressMode::ZPX, 4 }, { Operation::ROR, AddressMode::ZPX, 6 }, { Operation::RMB, AddressMode::ZP0, 5 }, { Operation::SEI, AddressMode::IMP, 2 }, { Operation::ADC, AddressMode::ABY, 4 }, { Operation::PLY, AddressMode::IMP, 4 }, { Operation::NOP, AddressMode::IMP, 1 }, { Operation::JMP, AddressMode::IAX, 6 }, { Operation::ADC, AddressMode::ABX, 4 }, { Operation::ROR, AddressMode::ABX, 6 }, { Operation::BBR, AddressMode::ZPR, 5 },
+/* 8 */	{ Operation::BRA, AddressMode::REL, 2 }, { Operation::STA, AddressMode::IXD, 6 }, { Operation::NOP, AddressMode::IMM, 2 }, { Operation::NOP, AddressMode::IMP, 1 }, { Operation::STY, AddressMode::ZP0, 3 }, { Operation::STA, AddressMode::ZP0, 3 }, { Operation::STX, AddressMode::ZP0, 3 }, { Operation::SMB, AddressMode::ZP0, 5 }, { Operation::DEY, AddressMode::IMP, 2 }, { Operation::BIT, AddressMode::IMM, 2 }, { Operation::TXA, AddressMode::IMP, 2 }, { Operation::NOP, AddressMode::IMP, 1 }, { Operation::STY, AddressMode::ABS, 4 }, { Operation::STA, AddressMode::ABS, 4 }, { Operation::STX, AddressMode::ABS, 4 }, { Operation::BBS, AddressMode::ZPR, 5 },
+/* 9 */	{ Operation::BCC, AddressMode::REL, 2 }, { Operation::STA, AddressMode::IYD, 6 }, { Operation::STA, AddressMode::ZPI, 5 }, { Operation::NOP, AddressMode::IMP, 1 }, { Operation::STY, AddressMode::ZPX, 4 }, { Operation::STA, AddressMode::ZPX, 4 }, { Operation::STX, AddressMode::ZPY, 4 }, { Operation::SMB, AddressMode::ZP0, 5 }, { Operation::TYA, AddressMode::IMP, 2 }, { Operation::STA, AddressMode::ABY, 5 }, { Operation::TXS, AddressMode::IMP, 2 }, { Operation::NOP, AddressMode::IMP, 1 }, { Operation::STZ, AddressMode::ABS, 4 }, { Operation::STA, AddressMode::ABX, 5 }, { Operation::STZ, AddressMode::ABX, 5 }, { Operation::BBS, AddressMode::ZPR, 5 },
+/* A */	{ Operation::LDY, AddressMode::IMM, 2 }, { Operation::LDA, AddressMode::IXD, 6 }, { Operation::LDX, AddressMode::IMM, 2 }, { Operation::NOP, AddressMode::IMP, 1 }, { Operation::LDY, AddressMode::ZP0, 3 }, { Operation::LDA, AddressMode::ZP0, 3 }, { Operation::LDX, AddressMode::ZP0, 3 }, { Operation::SMB, AddressMode::ZP0, 5 }, { Operation::TAY, AddressMode::IMP, 2 }, { Operation::LDA, AddressMode::IMM, 2 }, { Operation::TAX, AddressMode::IMP, 2 }, { Operation::NOP, AddressMode::IMP, 1 }, { Operation::LDY, AddressMode::ABS, 4 }, { Operation::LDA, AddressMode::ABS, 4 }, { Operation::LDX, AddressMode::ABS, 4 }, { Operation::BBS, AddressMode::ZPR, 5 },
+/* B */	{ Operation::BCS, AddressMode::REL, 2 }, { Operation::LDA, AddressMode::IYD, 5 }, { Operation::LDA, AddressMode::ZPI, 5 }, { Operation::NOP, AddressMode::IMP, 1 }, { Operation::LDY, AddressMode::ZPX, 4 }, { Operation::LDA, AddressMode::ZPX, 4 }, { Operation::LDX, AddressMode::ZPY, 4 }, { Operation::SMB, AddressMode::ZP0, 5 }, { Operation::CLV, AddressMode::IMP, 2 }, { Operation::LDA, AddressMode::ABY, 4 }, { Operation::TSX, AddressMode::IMP, 2 }, { Operation::NOP, AddressMode::IMP, 1 }, { Operation::LDY, AddressMode::ABX, 4 }, { Operation::LDA, AddressMode::ABX, 4 }, { Operation::LDX, AddressMode::ABY, 4 }, { Operation::BBS, AddressMode::ZPR, 5 },
+/* C */	{ Operation::CPY, AddressMode::IMM, 2 }, { Operation::CMP, AddressMode::IXD, 6 }, { Operation::NOP, AddressMode::IMM, 2 }, { Operation::NOP, AddressMode::IMP, 1 }, { Operation::CPY, AddressMode::ZP0, 3 }, { Operation::CMP, AddressMode::ZP0, 3 }, { Operation::DEC, AddressMode::ZP0, 5 }, { Operation::SMB, AddressMode::ZP0, 5 }, { Operation::INY, AddressMode::IMP, 2 }, { Operation::CMP, AddressMode::IMM, 2 }, { Operation::DEX, AddressMode::IMP, 2 }, { Operation::WAI, AddressMode::IMP, 3 }, { Operation::CPY, AddressMode::ABS, 4 }, { Operation::CMP, AddressMode::ABS, 4 }, { Operation::DEC, AddressMode::ABS, 6 }, { Operation::BBS, AddressMode::ZPR, 5 },
+/* D */	{ Operation::BNE, AddressMode::REL, 2 }, { Operation::CMP, AddressMode::IYD, 5 }, { Operation::CMP, AddressMode::ZPI, 5 }, { Operation::NOP, AddressMode::IMP, 1 }, { Operation::NOP, AddressMode::ZPX, 4 }, { Operation::CMP, AddressMode::ZPX, 4 }, { Operation::DEC, AddressMode::ZPX, 6 }, { Operation::SMB, AddressMode::ZP0, 5 }, { Operation::CLD, AddressMode::IMP, 2 }, { Operation::CMP, AddressMode::ABY, 4 }, { Operation::PHX, AddressMode::IMP, 3 }, { Operation::STP, AddressMode::IMP, 3 }, { Operation::NOP, AddressMode::ABS, 4 }, { Operation::CMP, AddressMode::ABX, 4 }, { Operation::DEC, AddressMode::ABX, 7 }, { Operation::BBS, AddressMode::ZPR, 5 },
+/* E */	{ Operation::CPX, AddressMode::IMM, 2 }, { Operation::SBC, AddressMode::IXD, 6 }, { Operation::NOP, AddressMode::IMM, 2 }, { Operation::NOP, AddressMode::IMP, 1 }, { Operation::CPX, AddressMode::ZP0, 3 }, { Operation::SBC, AddressMode::ZP0, 3 }, { Operation::INC, AddressMode::ZP0, 5 }, { Operation::SMB, AddressMode::ZP0, 5 }, { Operation::INX, AddressMode::IMP, 2 }, { Operation::SBC, AddressMode::IMM, 2 }, { Operation::NOP, AddressMode::IMP, 2 }, { Operation::NOP, AddressMode::IMP, 1 }, { Operation::CPX, AddressMode::ABS, 4 }, { Operation::SBC, AddressMode::ABS, 4 }, { Operation::INC, AddressMode::ABS, 6 }, { Operation::BBS, AddressMode::ZPR, 5 },
+/* F */	{ Operation::BEQ, AddressMode::REL, 2 }, { Operation::SBC, AddressMode::IYD, 5 }, { Operation::SBC, AddressMode::ZPI, 5 }, { Operation::NOP, AddressMode::IMP, 1 }, { Operation::NOP, AddressMode::ZPX, 4 }, { Operation::SBC, AddressMode::ZPX, 4 }, { Operation::INC, AddressMode::ZPX, 6 }, { Operation::SMB, AddressMode::ZP0, 5 }, { Operation::SED, AddressMode::IMP, 2 }, { Operation::SBC, AddressMode::ABY, 4 }, { Operation::PLX, AddressMode::IMP, 4 }, { Operation::NOP, AddressMode::IMP, 1 }, { Operation::NOP, AddressMode::ABS, 4 }, { Operation::SBC, AddressMode::ABX, 4 }, { Operation::INC, AddressMode::ABX, 7 }, { Operation::BBS, AddressMode::ZPR, 5 } }
+};
+
+
+// Names of the opcodes, for the disassembler
+constinit const std::array<std::string_view, 256> mos6502::mnemonics {
+/* 0 */	"BRK", "ORA", "NOP", "NOP", "TSB", "ORA", "ASL", "RMB0", "PHP", "ORA", "ASL", "NOP", "TSB", "ORA", "ASL", "BBR0",
+/* 1 */	"BPL", "ORA", "ORA", "NOP", "TRB", "ORA", "ASL", "RMB1", "CLC", "ORA", "INC", "NOP", "TRB", "ORA", "ASL", "BBR1",
+/* 2 */	"JSR", "AND", "NOP", "NOP", "BIT", "AND", "ROL", "RMB2", "PLP", "AND", "ROL", "NOP", "BIT", "AND", "ROL", "BBR2",
+/* 3 */	"BMI", "AND", "AND", "NOP", "BIT", "AND", "ROL", "RMB3", "SEC", "AND", "DEC", "NOP", "BIT", "AND", "ROL", "BBR3",
+/* 4 */	"RTI", "EOR", "NOP", "NOP", "NOP", "EOR", "LSR", "RMB4", "PHA", "EOR", "LSR", "NOP", "JMP", "EOR", "LSR", "BBR4",
+/* 5 */	"BVC", "EOR", "EOR", "NOP", "NOP", "EOR", "LSR", "RMB5", "CLI", "EOR", "PHY", "NOP", "NOP", "EOR", "LSR", "BBR5",
+/* 6 */	"RTS", "ADC", "NOP", "NOP", "STZ", "ADC", "ROR", "RMB6", "PLA", "ADC", "ROR", "NOP", "JMP", "ADC", "ROR", "BBR6",
+/* 7 */	"BVS", "ADC", "ADC", "NOP", "STZ", "ADC", "ROR", "RMB7", "SEI", "ADC", "PLY", "NOP", "JMP", "ADC", "ROR", "BBR7",
+/* 8 */	"BRA", "STA", "NOP", "NOP", "STY", "STA", "STX", "SMB0", "DEY", "BIT", "TXA", "NOP", "STY", "STA", "STX", "BBS0",
+/* 9 */	"BCC", "STA", "STA", "NOP", "STY", "STA", "STX", "SMB1", "TYA", "STA", "TXS", "NOP", "STZ", "STA", "STZ", "BBS1",
+/* A */	"LDY", "LDA", "LDX", "NOP", "LDY", "LDA", "LDX", "SMB2", "TAY", "LDA", "TAX", "NOP", "LDY", "LDA", "LDX", "BBS2",
+/* B */	"BCS", "LDA", "LDA", "NOP", "LDY", "LDA", "LDX", "SMB3", "CLV", "LDA", "TSX", "NOP", "LDY", "LDA", "LDX", "BBS3",
+/* C */	"CPY", "CMP", "NOP", "NOP", "CPY", "CMP", "DEC", "SMB4", "INY", "CMP", "DEX", "WAI", "CPY", "CMP", "DEC", "BBS4",
+/* D */	"BNE", "CMP", "CMP", "NOP", "NOP", "CMP", "DEC", "SMB5", "CLD", "CMP", "PHX", "STP", "NOP", "CMP", "DEC", "BBS5",
+/* E */	"CPX", "SBC", "NOP", "NOP", "CPX", "SBC", "INC", "SMB6", "INX", "SBC", "NOP", "NOP", "CPX", "SBC", "INC", "BBS6",
+/* F */	"BEQ", "SBC", "SBC", "NOP", "NOP", "SBC", "INC", "SMB7", "SED", "SBC", "PLX", "NOP", "NOP", "SBC", "INC", "BBS7"
+};
+
+
+// BRanch Always
+// goto PC + {relative}
+// Affects flags: none
+// Can require another cycle
+bool mos6502::BRA()
+{
+	++cycles;
+
+	abs_address = PC + rel_address;
+
+	if ((PC & 0xFF00) != (abs_address & 0xFF00))
+		++cycles;
+
+	PC = abs_address;
+
+	return false;
+}
+
+
+// PusH X register
+// Push X
+// Affects flags: none
+bool mos6502::PHX()
+{
+	write(0x0100 + SP--, X);
+
+	return false;
+}
+
+
+// PusH Y register
+// Push Y
+// Affects flags: none
+bool mos6502::PHY()
+{
+	write(0x0100 + SP--, Y);
+
+	return false;
+}
+
+
+// PuLl X register
+// Pull X
+// Affects flags: N,Z
+bool mos6502::PLX()
+{
+	X = read(0x0100 + (++SP));
+
+	setFlagStatus(Z, X == 0x00);
+	setFlagStatus(N, X & 0x80);
+
+	return false;
+}
+
+
+// PuLl Y register
+// Pull Y
+// Affects flags: N,Z
+bool mos6502::PLY()
+{
+	Y = read(0x0100 + (++SP));
+
+	setFlagStatus(Z, Y == 0x00);
+	setFlagStatus(N, Y & 0x80);
+
+	return false;
+}
+
+
+// STore Zero
+// {address} = 0
+// Affects flags: none
+bool mos6502::STZ()
+{
+	write(abs_address, 0x00);
+
+	return false;
+}
+
+
+// Test and Reset Bits
+// {address} = {fetched} & ~A
+// Affects flags: Z
+bool mos6502::TRB()
+{
+	setFlagStatus(Z, (A & fetched) == 0x00);
+
+	write(abs_address, fetched & ~A);
+
+	return false;
+}
+
+
+// Test and Set Bits
+// {address} = {fetched} | A
+// Affects flags: Z
+bool mos6502::TSB()
+{
+	setFlagStatus(Z, (A & fetched) == 0x00);
+
+	write(abs_address, fetched | A);
+
+	return false;
+}
+
+
+// Branch on Bit Reset (BBR0-BBR7, the bit is in the opcode)
+// if ({zero page} & (1 << bit) == 0) goto PC + {relative}
+// Affects flags: none
+// Can require another cycle
+bool mos6502::BBR()
+{
+	if (!(fetched & (1 << ((opcode >> 4) & 0x07))))
+	{
+		++cycles;
+
+		abs_address = PC + rel_address;
+
+		if ((PC & 0xFF00) != (abs_address & 0xFF00))
+			++cycles;
+
+		PC = abs_address;
+	}
+
+	return false;
+}
+
+
+// Branch on Bit Set (BBS0-BBS7, the bit is in the opcode)
+// if ({zero page} & (1 << bit) != 0) goto PC + {relative}
+// Affects flags: none
+// Can require another cycle
+bool mos6502::BBS()
+{
+	if (fetched & (1 << ((opcode >> 4) & 0x07)))
+	{
+		++cycles;
+
+		abs_address = PC + rel_address;
+
+		if ((PC & 0xFF00) != (abs_address & 0xFF00))
+			++cycles;
+
+		PC = abs_address;
+	}
+
+	return false;
+}
+
+
+// Reset Memory Bit (RMB0-RMB7, the bit is in the opcode)
+// {zero page} = {zero page} & ~(1 << bit)
+// Affects flags: none
+bool mos6502::RMB()
+{
+	write(abs_address, fetched & ~(1 << ((opcode >> 4) & 0x07)));
+
+	return false;
+}
+
+
+// Set Memory Bit (SMB0-SMB7, the bit is in the opcode)
+// {zero page} = {zero page} | (1 << bit)
+// Affects flags: none
+bool mos6502::SMB()
+{
+	write(abs_address, fetched | (1 << ((opcode >> 4) & 0x07)));
+
+	return false;
+}
+
+
+// WAit for Interrupt
+// Stops fetching instructions until an IRQ (even if masked) or an NMI
+// Affects flags: none
+bool mos6502::WAI()
+{
+	waiting = true;
+
+	return false;
+}
+
+
+// SToP the clock
+// Stops fetching instructions until a reset
+// Affects flags: none
+bool mos6502::STP()
+{
+	halt = Halt::Stop;
+
+	return false;
+}
+
+#endif
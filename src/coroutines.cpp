@@ -0,0 +1,94 @@
+///
+/// Implementation of CoroutineDevice
+///
+
+#include <cstdint>
+#include <utility>
+
+#include "../coroutines.h"
+
+
+CoroutineDevice::Task& CoroutineDevice::Task::operator=(Task&& other) noexcept
+{
+	if (this != &other)
+	{
+		if (handle)
+			handle.destroy();
+		handle = std::exchange(other.handle, nullptr);
+	}
+
+	return *this;
+}
+
+
+CoroutineDevice::Task::~Task()
+{
+	if (handle)
+		handle.destroy();
+}
+
+
+void CoroutineDevice::start(Task task)
+{
+	behavior = std::move(task);
+	current = synced;
+
+	suspended = behavior.handle;
+	resume(std::nullopt);
+}
+
+
+void CoroutineDevice::run(uint64_t cycles)
+{
+	uint64_t target = synced + cycles;
+
+	// Every wake up in the elapsed cycles, the behavior can schedule another one
+	while (wake <= target)
+	{
+		current = wake;
+		resume(std::nullopt);
+	}
+
+	current = target;
+}
+
+
+uint8_t CoroutineDevice::read(uint16_t address)
+{
+	uint8_t data = value(address);
+
+	if (waiting_access)
+		resume(Access{ address, data, false });
+
+	return data;
+}
+
+
+void CoroutineDevice::write(uint16_t address, uint8_t data)
+{
+	store(address, data);
+
+	if (waiting_access)
+		resume(Access{ address, data, true });
+}
+
+
+void CoroutineDevice::suspend(std::coroutine_handle<> handle, uint64_t wake_cycle, bool on_access)
+{
+	suspended = handle;
+	wake = wake_cycle;
+	waiting_access = on_access;
+}
+
+
+void CoroutineDevice::resume(std::optional<Access> access)
+{
+	last_access = access;
+	wake = never;
+	waiting_access = false;
+
+	std::exchange(suspended, nullptr).resume();
+
+	if (behavior.handle.done() && behavior.handle.promise().exception)
+		std::rethrow_exception(std::exchange(behavior.handle.promise().exception, nullptr));
+}
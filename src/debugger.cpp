@@ -0,0 +1,235 @@
+///
+/// Implementation of Debugger
+///
+
+#include <cstdint>
+#include <limits>
+
+#include "../debugger.h"
+
+
+bool Debugger::AddressSet::set(uint16_t address)
+{
+	uint64_t bit = uint64_t{ 1 } << (address & 63);
+	bool changed = !(bits[address >> 6] & bit);
+
+	bits[address >> 6] |= bit;
+	return changed;
+}
+
+
+bool Debugger::AddressSet::reset(uint16_t address)
+{
+	uint64_t bit = uint64_t{ 1 } << (address & 63);
+	bool changed = bits[address >> 6] & bit;
+
+	bits[address >> 6] &= ~bit;
+	return changed;
+}
+
+
+#ifdef MEMORY_HOOKS
+// Checks the accesses of every instruction against the watchpoints
+class Debugger::WatchHooks : public NoHooks
+{
+public:
+	static constexpr bool memory = true;
+
+	explicit WatchHooks(const Debugger& debugger)
+		: debugger{ debugger }
+	{ }
+
+	void read(uint16_t address, uint8_t data)
+	{
+		if (debugger.reads.test(address))
+			check(Reason::Read, address, data);
+	}
+
+	void write(uint16_t address, uint8_t data)
+	{
+		if (debugger.writes.test(address))
+			check(Reason::Write, address, data);
+	}
+
+	// Set by the first access that stops the execution
+	bool	 hit	 = false;
+	Reason	 kind	 = Reason::Limit;
+	uint16_t address = 0;
+	uint8_t	 value	 = 0;
+
+private:
+	void check(Reason kind, uint16_t address, uint8_t data)
+	{
+		if (hit)
+			return;
+
+		auto condition = debugger.conditions.find(conditionKey(kind, address));
+		if (condition != debugger.conditions.end() && condition->second != data)
+			return;
+
+		hit = true;
+		this->kind = kind;
+		this->address = address;
+		value = data;
+	}
+
+	const Debugger& debugger;
+};
+
+
+void Debugger::watchRead(uint16_t first, uint16_t last, std::optional<uint8_t> value)
+{
+	watch(Reason::Read, first, last, value);
+}
+
+
+void Debugger::watchWrite(uint16_t first, uint16_t last, std::optional<uint8_t> value)
+{
+	watch(Reason::Write, first, last, value);
+}
+#endif
+
+
+void Debugger::setBreakpoint(uint16_t address)
+{
+	breakpoint_count += breakpoints.set(address);
+}
+
+
+void Debugger::clearBreakpoint(uint16_t address)
+{
+	breakpoint_count -= breakpoints.reset(address);
+}
+
+
+void Debugger::breakAtCycle(uint64_t cycle)
+{
+	cycles.insert(cycle);
+}
+
+
+void Debugger::watch(Reason kind, uint16_t first, uint16_t last, std::optional<uint8_t> value)
+{
+	AddressSet& set = kind == Reason::Read ? reads : writes;
+
+	for (uint32_t address = first; address <= last; ++address)
+	{
+		watch_count += set.set(static_cast<uint16_t>(address));
+
+		if (value)
+			conditions[conditionKey(kind, static_cast<uint16_t>(address))] = *value;
+		else
+			conditions.erase(conditionKey(kind, static_cast<uint16_t>(address)));
+	}
+}
+
+
+void Debugger::clearWatchpoints(uint16_t first, uint16_t last)
+{
+	for (uint32_t address = first; address <= last; ++address)
+	{
+		watch_count -= reads.reset(static_cast<uint16_t>(address));
+		watch_count -= writes.reset(static_cast<uint16_t>(address));
+
+		conditions.erase(conditionKey(Reason::Read, static_cast<uint16_t>(address)));
+		conditions.erase(conditionKey(Reason::Write, static_cast<uint16_t>(address)));
+	}
+}
+
+
+void Debugger::clear()
+{
+	breakpoints.clear();
+	reads.clear();
+	writes.clear();
+	breakpoint_count = 0;
+	watch_count = 0;
+
+	conditions.clear();
+	cycles.clear();
+}
+
+
+bool Debugger::armed() const
+{
+	return breakpoint_count > 0 || watch_count > 0 || !cycles.empty();
+}
+
+
+uint32_t Debugger::conditionKey(Reason kind, uint16_t address)
+{
+	return (kind == Reason::Write ? 0x10000u : 0u) | address;
+}
+
+
+Debugger::Stop Debugger::run(mos6502& cpu, uint64_t max_cycles)
+{
+	// Cycles left by clock(), reset() or an interrupt belong to the previous instruction
+	cpu.finish();
+
+	auto stop = [&cpu](Reason reason, uint16_t address, uint8_t value) {
+		return Stop{ reason, cpu.PC, address, value, cpu.clock_count };
+	};
+
+	// Saturated, so that UINT64_MAX runs until something else stops
+	uint64_t limit = std::numeric_limits<uint64_t>::max();
+	if (max_cycles < limit - cpu.clock_count)
+		limit = cpu.clock_count + max_cycles;
+
+	// Cycle breakpoints just shorten the loop
+	uint64_t end = limit;
+	if (!cycles.empty() && *cycles.begin() < end)
+		end = *cycles.begin();
+
+	auto running = [&cpu, end] { return cpu.clock_count < end && cpu.halted() == mos6502::Halt::None; };
+
+	if (breakpoint_count == 0 && watch_count == 0)
+	{
+		while (running())
+			cpu.step();
+	}
+#ifdef MEMORY_HOOKS
+	else if (watch_count > 0)
+	{
+		WatchHooks hooks{ *this };
+
+		// The first instruction is executed even if PC is a breakpoint
+		for (bool first = true; running(); first = false)
+		{
+			if (!first && breakpoints.test(cpu.PC))
+				return stop(Reason::Breakpoint, cpu.PC, 0);
+
+			cpu.step(hooks);
+
+			if (hooks.hit)
+				return stop(hooks.kind, hooks.address, hooks.value);
+		}
+	}
+#endif
+	else
+	{
+		// The first instruction is executed even if PC is a breakpoint
+		if (running())
+			cpu.step();
+
+		while (running())
+		{
+			if (breakpoints.test(cpu.PC))
+				return stop(Reason::Breakpoint, cpu.PC, 0);
+
+			cpu.step();
+		}
+	}
+
+	if (cpu.halted() != mos6502::Halt::None)
+		return stop(Reason::Halt, cpu.PC, 0);
+
+	if (!cycles.empty() && *cycles.begin() <= cpu.clock_count)
+	{
+		// Every cycle breakpoint reached by the last instruction is consumed
+		cycles.erase(cycles.begin(), cycles.upper_bound(cpu.clock_count));
+		return stop(Reason::Cycle, 0, 0);
+	}
+
+	return stop(Reason::Limit, 0, 0);
+}
@@ -1,150 +1,336 @@
-///
-/// Implementation of mos6502::disasseble function
-/// 
-
-#include <cstdint>
-#include <sstream>
-#include <iomanip>
-#include <map>
-
-#include "../mos6502.h"
-
-
-// Converts a integer value to a hex-formatted string, with a custom prefix and length 
-template <typename Integer, std::streamsize length = sizeof(Integer) * 2>
-std::string to_hex(Integer value, const std::string& prefix = "$")
-{
-	static_assert(std::is_integral_v<Integer>, "The \"Integer\" type has to be a integral one");
-
-	static char digits[] = "0123456789ABCDEF";
-	std::string hex = prefix + std::string{length, '0'};
-	for (std::size_t i = 0, j = (length - 1) * 4; i < length; ++i, j -= 4) 
-		hex[prefix.length() + i] = digits[(value >> j) & 0x0F];
-	return hex;
-}
-
-
-std::map<uint16_t, std::string> mos6502::disassemble(uint16_t start_addr, uint16_t end_addr) const
-{
-	std::map<uint16_t, std::string> result;
-
-	for (auto address = start_addr; address < end_addr; )
-	{
-		// Save the address of the instruction to add the line at the end
-		auto inst_address = address;
-
-		std::stringstream line;
-
-		// Read the instruction in memory at current address
-		uint8_t opcode = read(address++);
-		const Instruction& instr = lookup[opcode];
-
-		// Add the instruction's to the line
-		line << instr.name;
-		
-		// No need to add something: addressing mode is implied
-		if (instr.address_mode == &mos6502::IMP);
-
-		else if (instr.address_mode == &mos6502::ACC)
-			line << " A";
-
-		// Add the data as a 1 byte constant value
-		else if (instr.address_mode == &mos6502::IMM)
-		{
-			uint8_t data = read(address++);
-			line << " #" << to_hex(data);
-		}
-
-		// Add the address as 2 byte constant value
-		else if (instr.address_mode == &mos6502::ABS)
-		{
-			uint16_t lo, hi;
-			lo = read(address++);
-			hi = read(address++);
-
-			uint16_t data = (hi << 8) | lo;
-			line << " " << to_hex(data);
-		}
-
-		// Add the address as 2 byte constant value
-		else if (instr.address_mode == &mos6502::ABX)
-		{
-			uint16_t lo, hi;
-			lo = read(address++);
-			hi = read(address++);
-
-			uint16_t data = (hi << 8) | lo;
-			line << " " << to_hex(data) << ",X";
-		}
-
-		// Add the address as 2 byte constant value
-		else if (instr.address_mode == &mos6502::ABY)
-		{
-			uint16_t lo, hi;
-			lo = read(address++);
-			hi = read(address++);
-
-			uint16_t data = (hi << 8) | lo;
-			line << " " << to_hex(data) << ",Y";
-		}
-
-		// Add the address as 1 byte constant value
-		else if (instr.address_mode == &mos6502::ZP0)
-		{
-			uint8_t data = read(address++);
-			line << " " << to_hex(data);
-		}
-
-		// Add the address as 1 byte constant value
-		else if (instr.address_mode == &mos6502::ZPX)
-		{
-			uint8_t data = read(address++);
-			line << " " << to_hex(data) << ",X";
-		}
-
-		// Add the address as 1 byte constant value
-		else if (instr.address_mode == &mos6502::ZPY)
-		{
-			uint8_t data = read(address++);
-			line << " " << to_hex(data) << ",Y";
-		}
-
-		// Add the address as 2 byte constant value
-		else if (instr.address_mode == &mos6502::IND)
-		{
-			uint16_t lo, hi;
-			lo = read(address++);
-			hi = read(address++);
-
-			uint16_t data = (hi << 8) | lo;
-			line << " (" << to_hex(data) << ")";
-		}
-
-		// Add the address as 1 byte constant value
-		else if (instr.address_mode == &mos6502::IXD)
-		{
-			uint8_t data = read(address++);
-			line << " (" << to_hex(data) << ",X)";
-		}
-
-		// Add the address as 1 byte constant value
-		else if (instr.address_mode == &mos6502::IYD)
-		{
-			uint8_t data = read(address++);
-			line << " (" << to_hex(data) << "),Y";
-		}
-
-		// Add the offset as 1 byte constant value
-		else if (instr.address_mode == &mos6502::REL)
-		{
-			uint16_t data = read(address++);
-			if (data & 0x80)
-				data |= 0xFF00;
-			line << " " << to_hex<uint16_t>(address + data);
-		}
-
-		result[inst_address] = line.str();
-	}
-
-	return result;
-}
\ No newline at end of file
+///
+/// Implementation of mos6502::disasseble function
+///
+
+#include <cstdint>
+#include <map>
+#include <string_view>
+#include <vector>
+
+#include "../mos6502.h"
+#include "../symbols.h"
+
+
+// Number of bytes of an instruction, indexed by addressing mode
+static constexpr uint8_t mode_length[] = {
+/*  IMP ACC IMM ZP0 ZPX ZPY ABS ABX ABY IND IXD IYD REL ZPI IAX ZPR */
+	1,  1,  2,  2,  2,  2,  3,  3,  3,  3,  2,  2,  2,  2,  3,  3
+};
+
+
+// Appends characters to a fixed size buffer, always leaving room for the null terminator
+class TextWriter
+{
+public:
+
+	TextWriter(std::span<char> buffer)
+		: buffer{ buffer }
+	{ }
+
+	void put(char c)
+	{
+		if (length + 1 < buffer.size())
+			buffer[length++] = c;
+	}
+
+	void put(std::string_view text)
+	{
+		for (char c : text)
+			put(c);
+	}
+
+	// Writes the value as hex digits, with a '$' prefix
+	void hex(uint16_t value, int digits)
+	{
+		static constexpr char hex_digits[] = "0123456789ABCDEF";
+
+		put('$');
+		for (int shift = (digits - 1) * 4; shift >= 0; shift -= 4)
+			put(hex_digits[(value >> shift) & 0x0F]);
+	}
+
+	// Terminates the string, returns its length
+	std::size_t finish()
+	{
+		if (!buffer.empty())
+			buffer[length] = '\0';
+		return length;
+	}
+
+private:
+	std::span<char> buffer;
+	std::size_t length = 0;
+};
+
+
+mos6502::AddressMode mos6502::addressMode(uint8_t opcode)
+{
+	return lookup[opcode].mode;
+}
+
+
+bool mos6502::pagePenalty(uint8_t opcode)
+{
+	return lookup[opcode].page_penalty;
+}
+
+
+bool mos6502::undocumented(uint8_t opcode)
+{
+	Operation operation = lookup[opcode].operation;
+
+	return (operation >= Operation::AAX && operation <= Operation::XAA)
+		|| (operation == Operation::NOP && opcode != 0xEA)
+		|| (operation == Operation::SBC && opcode == 0xEB);
+}
+
+
+uint8_t mos6502::length(uint8_t opcode)
+{
+	return mode_length[static_cast<uint8_t>(addressMode(opcode))];
+}
+
+
+uint8_t mos6502::baseCycles(uint8_t opcode)
+{
+	return lookup[opcode].cycles;
+}
+
+
+std::string_view mos6502::mnemonic(uint8_t opcode)
+{
+	return mnemonics[opcode];
+}
+
+
+template <typename Reader>
+mos6502::Disassembly mos6502::decode(uint16_t address, Reader read)
+{
+	Disassembly record{ };
+
+	record.address = address;
+	record.opcode  = read(address);
+	record.mode	   = addressMode(record.opcode);
+	record.length  = length(record.opcode);
+	record.cycles  = baseCycles(record.opcode);
+
+	for (uint8_t i = 1; i < record.length; ++i)
+		record.operands[i - 1] = read(static_cast<uint16_t>(address + i));
+
+	return record;
+}
+
+
+mos6502::Disassembly mos6502::decode(uint16_t address) const
+{
+	// Straight to the bus, disassembling is not an access made by the CPU
+	return decode(address, [this](uint16_t address) { return bus->read(address, true); });
+}
+
+
+mos6502::Disassembly mos6502::decode(std::span<const uint8_t, 0x10000> memory, uint16_t address)
+{
+	return decode(address, [memory](uint16_t address) { return memory[address]; });
+}
+
+
+std::size_t mos6502::disassemble(uint16_t start_addr, uint16_t end_addr, std::span<Disassembly> records) const
+{
+	std::size_t count = 0;
+
+	// A wider type avoids wrapping around at the end of memory
+	for (uint32_t address = start_addr; address < end_addr && count < records.size(); ++count)
+	{
+		records[count] = decode(static_cast<uint16_t>(address));
+		address += records[count].length;
+	}
+
+	return count;
+}
+
+
+// Writes the instruction's text, symbol(address) gives the name to print instead of an address
+template <typename Symbols>
+static std::size_t formatWith(const mos6502::Disassembly& record, std::span<char> buffer, Symbols symbol)
+{
+	using AddressMode = mos6502::AddressMode;
+
+	TextWriter text{ buffer };
+
+	uint8_t  byte = record.operands[0];
+	uint16_t word = (static_cast<uint16_t>(record.operands[1]) << 8) | record.operands[0];
+
+	// Writes the symbol of the address if there's one, otherwise the address itself
+	auto address = [&](uint16_t value, int digits) {
+		if (std::string_view name = symbol(value); !name.empty())
+			text.put(name);
+		else
+			text.hex(value, digits);
+	};
+
+	// Add the instruction's to the line
+	text.put(mos6502::mnemonic(record.opcode));
+
+	switch (record.mode)
+	{
+	// No need to add something: addressing mode is implied
+	case AddressMode::IMP:
+		break;
+
+	case AddressMode::ACC:
+		text.put(" A");
+		break;
+
+	// Add the data as a 1 byte constant value
+	case AddressMode::IMM:
+		text.put(" #");
+		text.hex(byte, 2);
+		break;
+
+	// Add the address as 2 byte constant value
+	case AddressMode::ABS:
+		text.put(' ');
+		address(word, 4);
+		break;
+
+	case AddressMode::ABX:
+		text.put(' ');
+		address(word, 4);
+		text.put(",X");
+		break;
+
+	case AddressMode::ABY:
+		text.put(' ');
+		address(word, 4);
+		text.put(",Y");
+		break;
+
+	case AddressMode::IND:
+		text.put(" (");
+		address(word, 4);
+		text.put(')');
+		break;
+
+	// Add the address as 1 byte constant value
+	case AddressMode::ZP0:
+		text.put(' ');
+		address(byte, 2);
+		break;
+
+	case AddressMode::ZPX:
+		text.put(' ');
+		address(byte, 2);
+		text.put(",X");
+		break;
+
+	case AddressMode::ZPY:
+		text.put(' ');
+		address(byte, 2);
+		text.put(",Y");
+		break;
+
+	case AddressMode::IXD:
+		text.put(" (");
+		address(byte, 2);
+		text.put(",X)");
+		break;
+
+	case AddressMode::IYD:
+		text.put(" (");
+		address(byte, 2);
+		text.put("),Y");
+		break;
+
+	// Add the branch target, computed from the offset
+	case AddressMode::REL:
+		text.put(' ');
+		address(static_cast<uint16_t>(record.address + record.length + static_cast<int8_t>(byte)), 4);
+		break;
+
+	case AddressMode::ZPI:
+		text.put(" (");
+		address(byte, 2);
+		text.put(')');
+		break;
+
+	case AddressMode::IAX:
+		text.put(" (");
+		address(word, 4);
+		text.put(",X)");
+		break;
+
+	// Add the zero page address and the branch target
+	case AddressMode::ZPR:
+		text.put(' ');
+		address(byte, 2);
+		text.put(',');
+		address(static_cast<uint16_t>(record.address + record.length + static_cast<int8_t>(record.operands[1])), 4);
+		break;
+	}
+
+	return text.finish();
+}
+
+
+std::size_t mos6502::format(const Disassembly& record, std::span<char> buffer)
+{
+	return formatWith(record, buffer, [](uint16_t) { return std::string_view{ }; });
+}
+
+
+std::size_t mos6502::format(const Disassembly& record, std::span<char> buffer, const SymbolTable& symbols)
+{
+	return formatWith(record, buffer, [&symbols](uint16_t address) { return symbols.find(address); });
+}
+
+
+std::map<uint16_t, std::string> mos6502::disassemble(uint16_t start_addr, uint16_t end_addr) const
+{
+	std::map<uint16_t, std::string> result;
+
+	char line[max_format_length];
+
+	for (uint32_t address = start_addr; address < end_addr; )
+	{
+		Disassembly record = decode(static_cast<uint16_t>(address));
+		address += record.length;
+
+		std::size_t length = format(record, line);
+		result.emplace_hint(result.end(), record.address, std::string{ line, length });
+	}
+
+	return result;
+}
+
+
+std::map<uint16_t, std::string> mos6502::disassemble(uint16_t start_addr, uint16_t end_addr, const SymbolTable& symbols) const
+{
+	std::map<uint16_t, std::string> result;
+
+	// Every instruction of the range, at most one per byte
+	std::vector<Disassembly> records(end_addr > start_addr ? end_addr - start_addr : 0);
+	records.resize(disassemble(start_addr, end_addr, records));
+
+	// The targets of branches and jumps get a name, printed in the operands and defined at their address
+	SymbolTable labels = symbols;
+	labels.generateLabels(records);
+
+	char line[256];
+
+	for (const Disassembly& record : records)
+	{
+		std::size_t length = format(record, line, labels);
+
+		std::string text;
+		if (std::string_view name = labels.find(record.address); !name.empty())
+		{
+			text.append(name);
+			text.append(":\n");
+		}
+		text.append(line, length);
+
+		result.emplace_hint(result.end(), record.address, std::move(text));
+	}
+
+	return result;
+}
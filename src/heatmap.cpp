@@ -0,0 +1,106 @@
+///
+/// Implementation of MemoryHeatmap
+///
+
+#include <cstdint>
+#include <algorithm>
+#include <cmath>
+#include <cstdio>
+#include <vector>
+
+#include "../heatmap.h"
+
+
+void MemoryHeatmap::reset()
+{
+	reads.fill(0);
+	writes.fill(0);
+	executes.fill(0);
+}
+
+
+void MemoryHeatmap::sample(MemoryHeatmap& snapshot)
+{
+	snapshot.reads = reads;
+	snapshot.writes = writes;
+	snapshot.executes = executes;
+
+	reset();
+}
+
+
+std::array<MemoryHeatmap::Page, 256> MemoryHeatmap::pages() const
+{
+	std::array<Page, 256> result{ };
+
+	for (std::size_t address = 0; address < 0x10000; ++address)
+	{
+		result[address >> 8].reads	  += reads[address];
+		result[address >> 8].writes	  += writes[address];
+		result[address >> 8].executes += executes[address];
+	}
+
+	return result;
+}
+
+
+void MemoryHeatmap::writeCsv(std::ostream& out, bool per_page) const
+{
+	char line[96];
+
+	auto write = [&](const char* format, unsigned address, uint64_t r, uint64_t w, uint64_t x) {
+		if (r == 0 && w == 0 && x == 0)
+			return;
+
+		std::snprintf(line, sizeof(line), format, address,
+			static_cast<unsigned long long>(r), static_cast<unsigned long long>(w), static_cast<unsigned long long>(x));
+		out << line;
+	};
+
+	if (per_page)
+	{
+		out << "page,reads,writes,executes\n";
+
+		auto summed = pages();
+		for (unsigned page = 0; page < summed.size(); ++page)
+			write("$%02X,%llu,%llu,%llu\n", page, summed[page].reads, summed[page].writes, summed[page].executes);
+	}
+	else
+	{
+		out << "address,reads,writes,executes\n";
+
+		for (unsigned address = 0; address < 0x10000; ++address)
+			write("$%04X,%llu,%llu,%llu\n", address, reads[address], writes[address], executes[address]);
+	}
+}
+
+
+void MemoryHeatmap::writePpm(std::ostream& out) const
+{
+	// Scales a counter to 0-255, with the logarithm of the counter relative to the maximum
+	auto scale = [](const std::array<uint64_t, 0x10000>& counters) {
+		uint64_t max = *std::max_element(counters.begin(), counters.end());
+		double log_max = std::log1p(static_cast<double>(max));
+
+		return [&counters, log_max](std::size_t address) -> uint8_t {
+			if (counters[address] == 0)
+				return 0;
+			return static_cast<uint8_t>(std::lround(255.0 * std::log1p(static_cast<double>(counters[address])) / log_max));
+		};
+	};
+
+	auto red = scale(writes);
+	auto green = scale(reads);
+	auto blue = scale(executes);
+
+	std::vector<uint8_t> pixels(0x10000 * 3);
+	for (std::size_t address = 0; address < 0x10000; ++address)
+	{
+		pixels[address * 3 + 0] = red(address);
+		pixels[address * 3 + 1] = green(address);
+		pixels[address * 3 + 2] = blue(address);
+	}
+
+	out << "P6\n256 256\n255\n";
+	out.write(reinterpret_cast<const char*>(pixels.data()), static_cast<std::streamsize>(pixels.size()));
+}
@@ -0,0 +1,259 @@
+///
+/// Implementation of the program loaders
+///
+
+#include <cstdint>
+#include <algorithm>
+#include <array>
+#include <cstdio>
+#include <stdexcept>
+#include <string>
+
+#include "../loaders.h"
+#include "../mapped_file.h"
+
+
+namespace
+{
+	constexpr std::size_t memory_size = 0x10000;
+	constexpr uint16_t	  reset_vector = 0xFFFC;
+
+	// Throws if size bytes don't fit at address
+	void checkFits(uint32_t address, std::size_t size, const char* format)
+	{
+		if (size > memory_size - address)
+		{
+			char text[64];
+			std::snprintf(text, sizeof(text), " image of %zu bytes at $%04X goes past $FFFF", size, static_cast<unsigned>(address));
+			throw std::runtime_error(format + std::string(text));
+		}
+	}
+
+	// Points the reset vector to entry. Without an explicit entry, an image that has its own vector keeps it
+	uint16_t setEntry(Bus& bus, std::optional<uint16_t> entry, uint16_t fallback, bool has_vector)
+	{
+		if (!entry && has_vector)
+			return static_cast<uint16_t>(bus.ram[reset_vector] | (bus.ram[reset_vector + 1] << 8));
+
+		uint16_t address = entry.value_or(fallback);
+		bus.ram[reset_vector] = address & 0xFF;
+		bus.ram[reset_vector + 1] = address >> 8;
+
+		return address;
+	}
+
+	// Copies bytes at address, that must fit
+	void copy(Bus& bus, std::span<const uint8_t> bytes, uint16_t address)
+	{
+		std::copy(bytes.begin(), bytes.end(), bus.ram.begin() + address);
+	}
+
+	// Value of a hex digit, -1 if it isn't one
+	int hexDigit(char c)
+	{
+		if (c >= '0' && c <= '9') return c - '0';
+		if (c >= 'A' && c <= 'F') return c - 'A' + 10;
+		if (c >= 'a' && c <= 'f') return c - 'a' + 10;
+		return -1;
+	}
+}
+
+
+LoadedImage loadRaw(Bus& bus, std::span<const uint8_t> bytes, uint16_t address, std::optional<uint16_t> entry)
+{
+	checkFits(address, bytes.size(), "raw");
+	copy(bus, bytes, address);
+
+	bool has_vector = address <= reset_vector && bytes.size() >= reset_vector + 2u - address;
+	return { address, bytes.size(), setEntry(bus, entry, address, has_vector) };
+}
+
+
+LoadedImage loadRawFile(Bus& bus, const std::string& path, uint16_t address, std::optional<uint16_t> entry)
+{
+	MappedFile file{ path };
+	return loadRaw(bus, file.bytes(), address, entry);
+}
+
+
+LoadedImage loadPrg(Bus& bus, std::span<const uint8_t> bytes, std::optional<uint16_t> entry)
+{
+	if (bytes.size() < 2)
+		throw std::runtime_error("PRG image without a load address");
+
+	uint16_t address = static_cast<uint16_t>(bytes[0] | (bytes[1] << 8));
+	std::span<const uint8_t> program = bytes.subspan(2);
+
+	checkFits(address, program.size(), "PRG");
+	copy(bus, program, address);
+
+	bool has_vector = address <= reset_vector && program.size() >= reset_vector + 2u - address;
+	return { address, program.size(), setEntry(bus, entry, address, has_vector) };
+}
+
+
+LoadedImage loadPrgFile(Bus& bus, const std::string& path, std::optional<uint16_t> entry)
+{
+	MappedFile file{ path };
+	return loadPrg(bus, file.bytes(), entry);
+}
+
+
+LoadedImage loadINes(Bus& bus, std::span<const uint8_t> bytes)
+{
+	constexpr std::size_t header_size = 16;
+	constexpr std::size_t trainer_size = 512;
+	constexpr std::size_t bank_size = 0x4000;
+
+	if (bytes.size() < header_size || !std::equal(bytes.begin(), bytes.begin() + 4, "NES\x1A"))
+		throw std::runtime_error("not an iNES image");
+
+	std::size_t banks = bytes[4];
+	unsigned mapper = (bytes[6] >> 4) | (bytes[7] & 0xF0);
+	std::size_t offset = header_size + ((bytes[6] & 0x04) ? trainer_size : 0);
+
+	if (mapper != 0)
+		throw std::runtime_error("iNES mapper " + std::to_string(mapper) + " is not supported, only NROM (0)");
+	if (banks != 1 && banks != 2)
+		throw std::runtime_error("NROM with " + std::to_string(banks) + " PRG ROM banks, 1 or 2 expected");
+	if (bytes.size() < offset + banks * bank_size)
+		throw std::runtime_error("iNES image truncated in the PRG ROM");
+
+	std::span<const uint8_t> prg = bytes.subspan(offset, banks * bank_size);
+
+	// NROM-128 is mirrored in the upper bank
+	copy(bus, prg, 0x8000);
+	if (banks == 1)
+		copy(bus, prg, 0xC000);
+
+	return { 0x8000, 2 * bank_size, setEntry(bus, std::nullopt, 0x8000, true) };
+}
+
+
+LoadedImage loadINesFile(Bus& bus, const std::string& path)
+{
+	MappedFile file{ path };
+	return loadINes(bus, file.bytes());
+}
+
+
+LoadedImage loadIntelHex(Bus& bus, std::string_view text)
+{
+	uint32_t base = 0;
+	uint32_t lowest = memory_size;
+	std::size_t written = 0;
+	std::optional<uint16_t> entry;
+	bool vector_lo = false, vector_hi = false;
+	bool end = false;
+
+	std::array<uint8_t, 5 + 255> record;
+	std::size_t line_number = 0;
+
+	while (!text.empty() && !end)
+	{
+		std::size_t eol = text.find('\n');
+		std::string_view line = text.substr(0, eol);
+		text.remove_prefix(eol == std::string_view::npos ? text.size() : eol + 1);
+		++line_number;
+
+		auto fail = [line_number](const std::string& message) {
+			return std::runtime_error("Intel HEX line " + std::to_string(line_number) + ": " + message);
+		};
+
+		if (!line.empty() && line.back() == '\r')
+			line.remove_suffix(1);
+		if (line.empty())
+			continue;
+
+		std::size_t count = (line.size() - 1) / 2;
+		if (line[0] != ':' || count < 5 || count > record.size() || line.size() % 2 == 0)
+			throw fail("malformed record");
+
+		// Length, address, type, data and checksum, in one pass over the digits
+		uint8_t sum = 0;
+		for (std::size_t i = 0; i < count; ++i)
+		{
+			int hi = hexDigit(line[1 + 2 * i]);
+			int lo = hexDigit(line[2 + 2 * i]);
+			if (hi < 0 || lo < 0)
+				throw fail("invalid hex digit");
+
+			record[i] = static_cast<uint8_t>(hi << 4 | lo);
+			sum += record[i];
+		}
+
+		std::size_t length = record[0];
+		if (count != length + 5)
+			throw fail("length doesn't match the record");
+		if (sum != 0)
+			throw fail("bad checksum");
+
+		uint16_t offset = static_cast<uint16_t>(record[1] << 8 | record[2]);
+		std::span<const uint8_t> data{ record.data() + 4, length };
+
+		switch (record[3])
+		{
+		case 0x00:
+		{
+			uint32_t address = base + offset;
+			if (address + length > memory_size)
+				throw fail("data past $FFFF");
+
+			copy(bus, data, static_cast<uint16_t>(address));
+
+			written += length;
+			lowest = std::min(lowest, address);
+			vector_lo = vector_lo || (address <= reset_vector && address + length > reset_vector);
+			vector_hi = vector_hi || (address <= reset_vector + 1u && address + length > reset_vector + 1u);
+			break;
+		}
+
+		case 0x01:
+			end = true;
+			break;
+
+		case 0x02:
+		case 0x04:
+			if (length != 2)
+				throw fail("extended address record without 2 bytes");
+
+			base = record[3] == 0x02 ? (data[0] << 8 | data[1]) * 16u : uint32_t{ data[0] } << 24 | uint32_t{ data[1] } << 16;
+			if (base >= memory_size)
+				throw fail("extended address past $FFFF");
+			break;
+
+		case 0x03:
+		case 0x05:
+		{
+			if (length != 4)
+				throw fail("start address record without 4 bytes");
+
+			uint32_t start = record[3] == 0x03 ? (data[0] << 8 | data[1]) * 16u + (data[2] << 8 | data[3])
+											   : uint32_t{ data[0] } << 24 | uint32_t{ data[1] } << 16 | data[2] << 8 | data[3];
+			if (start >= memory_size)
+				throw fail("start address past $FFFF");
+
+			entry = static_cast<uint16_t>(start);
+			break;
+		}
+
+		default:
+			throw fail("unknown record type " + std::to_string(record[3]));
+		}
+	}
+
+	if (!end)
+		throw std::runtime_error("Intel HEX without an end of file record");
+
+	uint16_t start = written ? static_cast<uint16_t>(lowest) : 0;
+	return { start, written, setEntry(bus, entry, start, vector_lo && vector_hi) };
+}
+
+
+LoadedImage loadIntelHexFile(Bus& bus, const std::string& path)
+{
+	MappedFile file{ path };
+	std::span<const uint8_t> bytes = file.bytes();
+
+	return loadIntelHex(bus, { reinterpret_cast<const char*>(bytes.data()), bytes.size() });
+}
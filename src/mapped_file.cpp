@@ -0,0 +1,115 @@
+///
+/// Implementation of MappedFile, with mmap() or with a plain read
+///
+
+#include <cstdint>
+#include <cerrno>
+#include <fstream>
+#include <system_error>
+#include <utility>
+
+#if __has_include(<sys/mman.h>)
+#define MAPPED_FILE_MMAP
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+#include "../mapped_file.h"
+
+
+#ifdef MAPPED_FILE_MMAP
+MappedFile::MappedFile(const std::string& path)
+{
+	int fd = ::open(path.c_str(), O_RDONLY);
+	if (fd < 0)
+		throw std::system_error(errno, std::generic_category(), path);
+
+	struct stat info{ };
+	if (::fstat(fd, &info) != 0)
+	{
+		int error = errno;
+		::close(fd);
+		throw std::system_error(error, std::generic_category(), path);
+	}
+
+	size = static_cast<std::size_t>(info.st_size);
+
+	// Empty files can't be mapped, they're just an empty span
+	if (size > 0)
+	{
+		void* address = ::mmap(nullptr, size, PROT_READ, MAP_PRIVATE, fd, 0);
+		if (address == MAP_FAILED)
+		{
+			int error = errno;
+			::close(fd);
+			throw std::system_error(error, std::generic_category(), path);
+		}
+
+		data = static_cast<const uint8_t*>(address);
+	}
+
+	::close(fd);
+}
+
+
+void MappedFile::release()
+{
+	if (data)
+		::munmap(const_cast<uint8_t*>(data), size);
+}
+#else
+MappedFile::MappedFile(const std::string& path)
+{
+	std::ifstream file{ path, std::ios::binary | std::ios::ate };
+	if (!file)
+		throw std::system_error(std::make_error_code(std::errc::no_such_file_or_directory), path);
+
+	size = static_cast<std::size_t>(file.tellg());
+	copy = std::make_unique<uint8_t[]>(size);
+	data = copy.get();
+
+	file.seekg(0);
+	if (!file.read(reinterpret_cast<char*>(copy.get()), static_cast<std::streamsize>(size)))
+		throw std::system_error(std::make_error_code(std::errc::io_error), path);
+}
+
+
+void MappedFile::release()
+{
+	copy.reset();
+}
+#endif
+
+
+MappedFile::~MappedFile()
+{
+	release();
+}
+
+
+MappedFile::MappedFile(MappedFile&& other) noexcept
+	: data{ std::exchange(other.data, nullptr) }, size{ std::exchange(other.size, 0) }, copy{ std::move(other.copy) }
+{ }
+
+
+MappedFile& MappedFile::operator=(MappedFile&& other) noexcept
+{
+	if (this != &other)
+	{
+		release();
+
+		data = std::exchange(other.data, nullptr);
+		size = std::exchange(other.size, 0);
+		copy = std::move(other.copy);
+	}
+
+	return *this;
+}
+
+
+std::span<const uint8_t> MappedFile::bytes() const
+{
+	return { data, size };
+}
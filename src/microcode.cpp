@@ -0,0 +1,421 @@
+///
+/// Implementation of the microcoded core (tick()): every cycle makes the bus access of the real
+/// NMOS 6502, dummy reads and writes included. Not available with CMOS_65C02
+///
+
+#include <cstdint>
+#include <array>
+#include <functional>
+#include <initializer_list>
+
+#include "../mos6502.h"
+
+#ifdef MEMORY_STATISTICS
+#include "../heatmap.h"
+#endif
+
+#ifdef HLE_TRAPS
+#include "../traps.h"
+#endif
+
+#ifndef CMOS_65C02
+
+
+// The bus access of a cycle, after the opcode fetch, and what is done with it.
+// The instructions are executed by the same routines of the other cores, called at the cycle of their access
+enum class mos6502::MicroOp : uint8_t {
+	End,			// The instruction is complete, the cycles left by the lookup array are dummy reads of PC
+	DummyRead,		// Read PC
+	SkipByte,		// Read PC, increment PC (BRK)
+	Implied,		// Read PC, execute the instruction (implied and accumulator modes)
+	Immediate,		// Read PC into fetched, increment PC, execute the instruction
+	ImmediateStore, // Increment PC, execute the instruction that stores at the operand address
+	ZeroPage,		// Read PC into the address low byte, increment PC
+	ZeroPageX,		// Read the zero page address, add X to it
+	ZeroPageY,		// Read the zero page address, add Y to it
+	AddressLo,		// Read PC into the address low byte, increment PC
+	AddressHi,		// Read PC into the address high byte, increment PC
+	AddressHiX,		// Same as above, add X to the address
+	AddressHiY,		// Same as above, add Y to the address
+	Pointer,		// Read PC into the zero page pointer, increment PC
+	PointerX,		// Read the pointer, add X to it
+	PointerLo,		// Read the address low byte at the pointer
+	PointerHi,		// Read the address high byte at the pointer + 1 (in zero page)
+	PointerHiY,		// Same as above, add Y to the address
+	IndexFix,		// Read the address before fixing its high byte
+	IndexRead,		// Same as above, it's the data read when the page is not crossed (one cycle less)
+	Read,			// Read the data, execute the instruction
+	Write,			// Execute the instruction, that writes the data
+	Modify,			// Read the data
+	ModifyWrite,	// Write back the data not modified yet
+	ModifyOp,		// Execute the instruction, that writes the modified data
+	Operation,		// Execute the instruction, that pushes or pulls a register
+	Stack,			// Read the top of the stack
+	PushPCH,		// Push the PC high byte
+	PushPCL,		// Push the PC low byte
+	PushBreak,		// Push P with B set, set I
+	VectorLo,		// Read the BRK vector low byte
+	VectorHi,		// Read the BRK vector high byte, jump
+	JumpHi,			// Read PC into the address high byte, jump (JMP, JSR after pushing PC)
+	IndirectLo,		// Read the target low byte at the address
+	IndirectHi,		// Read the target high byte at the address + 1 (same page), jump
+	PullP,			// Pull P
+	PullPCL,		// Pull the PC low byte
+	PullPCH,		// Pull the PC high byte
+	Return,			// Read PC, increment PC (RTS)
+	Branch,			// Read PC into the offset, increment PC, execute the branch
+	BranchTaken,	// Read PC before the branch
+	BranchFix		// Read the target before fixing its high byte
+};
+
+
+auto mos6502::microcode() -> const std::array<std::array<MicroOp, max_micro_ops>, 256>&
+{
+	// Built once from the lookup table
+	static const std::array<std::array<MicroOp, max_micro_ops>, 256> programs = [] {
+		std::array<std::array<MicroOp, max_micro_ops>, 256> programs{ };
+
+		for (std::size_t i = 0; i < lookup.size(); ++i)
+		{
+			AddressMode mode = lookup[i].mode;
+			Operation operation = lookup[i].operation;
+
+			std::size_t length = 0;
+			auto add = [&](std::initializer_list<MicroOp> ops) {
+				for (MicroOp op : ops)
+					programs[i][length++] = op;
+			};
+
+			bool store = operation == Operation::STA || operation == Operation::STX || operation == Operation::STY ||
+						 operation == Operation::AAX || operation == Operation::AXA || operation == Operation::SAX ||
+						 operation == Operation::SXA || operation == Operation::SYA || operation == Operation::TAS;
+
+			bool modify = operation == Operation::ASL || operation == Operation::LSR || operation == Operation::ROL ||
+						  operation == Operation::ROR || operation == Operation::INC || operation == Operation::DEC ||
+						  operation == Operation::SLO || operation == Operation::RLA || operation == Operation::SRE ||
+						  operation == Operation::RRA || operation == Operation::DCP || operation == Operation::ISC;
+
+			// Instructions with their own sequence
+			if (operation == Operation::BRK)
+				add({ MicroOp::SkipByte, MicroOp::PushPCH, MicroOp::PushPCL, MicroOp::PushBreak, MicroOp::VectorLo, MicroOp::VectorHi });
+			else if (operation == Operation::JSR)
+				add({ MicroOp::AddressLo, MicroOp::Stack, MicroOp::PushPCH, MicroOp::PushPCL, MicroOp::JumpHi });
+			else if (operation == Operation::RTS)
+				add({ MicroOp::DummyRead, MicroOp::Stack, MicroOp::PullPCL, MicroOp::PullPCH, MicroOp::Return });
+			else if (operation == Operation::RTI)
+				add({ MicroOp::DummyRead, MicroOp::Stack, MicroOp::PullP, MicroOp::PullPCL, MicroOp::PullPCH });
+			else if (operation == Operation::PHA || operation == Operation::PHP)
+				add({ MicroOp::DummyRead, MicroOp::Operation });
+			else if (operation == Operation::PLA || operation == Operation::PLP)
+				add({ MicroOp::DummyRead, MicroOp::Stack, MicroOp::Operation });
+			else if (operation == Operation::JMP && mode == AddressMode::ABS)
+				add({ MicroOp::AddressLo, MicroOp::JumpHi });
+			else if (operation == Operation::JMP)
+				add({ MicroOp::AddressLo, MicroOp::AddressHi, MicroOp::IndirectLo, MicroOp::IndirectHi });
+			else if (mode == AddressMode::REL)
+				add({ MicroOp::Branch, MicroOp::BranchTaken, MicroOp::BranchFix });
+			else if (mode == AddressMode::IMP || mode == AddressMode::ACC)
+				add({ MicroOp::Implied });
+			else if (mode == AddressMode::IMM)
+				add({ store ? MicroOp::ImmediateStore : MicroOp::Immediate });
+			else
+			{
+				// Indexed reads that can take one cycle less use the uncorrected address as data
+				MicroOp index = (!store && !modify && pagePenalty(static_cast<uint8_t>(i))) ? MicroOp::IndexRead : MicroOp::IndexFix;
+
+				if		(mode == AddressMode::ZP0) add({ MicroOp::ZeroPage });
+				else if (mode == AddressMode::ZPX) add({ MicroOp::ZeroPage, MicroOp::ZeroPageX });
+				else if (mode == AddressMode::ZPY) add({ MicroOp::ZeroPage, MicroOp::ZeroPageY });
+				else if (mode == AddressMode::ABS) add({ MicroOp::AddressLo, MicroOp::AddressHi });
+				else if (mode == AddressMode::ABX) add({ MicroOp::AddressLo, MicroOp::AddressHiX, index });
+				else if (mode == AddressMode::ABY) add({ MicroOp::AddressLo, MicroOp::AddressHiY, index });
+				else if (mode == AddressMode::IXD) add({ MicroOp::Pointer, MicroOp::PointerX, MicroOp::PointerLo, MicroOp::PointerHi });
+				else if (mode == AddressMode::IYD) add({ MicroOp::Pointer, MicroOp::PointerLo, MicroOp::PointerHiY, index });
+
+				if (store)
+					add({ MicroOp::Write });
+				else if (modify)
+					add({ MicroOp::Modify, MicroOp::ModifyWrite, MicroOp::ModifyOp });
+				else
+					add({ MicroOp::Read });
+			}
+		}
+
+		return programs;
+	}();
+
+	return programs;
+}
+
+
+bool mos6502::tick()
+{
+	// clock_count is incremented after the access, so that it's the cycle of the access for the bus
+
+	if (micro_cycle == 0 && cycles == 0)
+		updateDevices();
+
+	// Cycles left by reset() or an interrupt, whose accesses are already done
+	if (micro_cycle == 0 && cycles > 0)
+	{
+		++clock_count;
+		return --cycles == 0;
+	}
+
+	// A halted CPU runs idle cycles
+	if (micro_cycle == 0 && halt != Halt::None)
+	{
+		++clock_count;
+		return true;
+	}
+
+#ifdef HLE_TRAPS
+	// The trap makes its accesses at once, like an interrupt
+	if (micro_cycle == 0 && traps && traps->test(PC))
+	{
+		trap();
+		++clock_count;
+		return --cycles == 0;
+	}
+#endif
+
+	if (micro_cycle == 0)
+	{
+#ifdef MEMORY_STATISTICS
+		if (heatmap)
+			++heatmap->executes[PC];
+#endif
+
+		micro_pc = PC;
+		micro_crossed = false;
+		opcode = read(PC++);
+		cycles = lookup[opcode].cycles;
+	}
+	else
+	{
+		const auto& program = microcode()[opcode];
+		microStep(micro_cycle <= max_micro_ops ? program[micro_cycle - 1] : MicroOp::End);
+	}
+
+	++clock_count;
+	++micro_cycle;
+
+	// Branches and page crossings add cycles while the instruction is executed
+	if (--cycles > 0)
+		return false;
+
+#ifdef OPCODE_STATISTICS
+	countInstruction(micro_cycle, micro_crossed);
+#endif
+
+	micro_cycle = 0;
+
+	if (halt_on_loops)
+		detectLoop(micro_pc);
+
+	return true;
+}
+
+
+void mos6502::completeInstruction()
+{
+	while (micro_cycle != 0)
+		tick();
+}
+
+
+void mos6502::microStep(MicroOp op)
+{
+	auto execute = [this] { std::invoke(operations[static_cast<uint8_t>(lookup[opcode].operation)], *this); };
+
+	switch (op)
+	{
+	case MicroOp::End:
+	case MicroOp::DummyRead:
+		read(PC);
+		break;
+
+	case MicroOp::SkipByte:
+		read(PC++);
+		break;
+
+	case MicroOp::Implied:
+		read(PC);
+		fetched = fetch();
+		execute();
+		break;
+
+	case MicroOp::Immediate:
+		abs_address = PC++;
+		fetched = read(abs_address);
+		execute();
+		break;
+
+	case MicroOp::ImmediateStore:
+		abs_address = PC++;
+		execute();
+		break;
+
+	case MicroOp::ZeroPage:
+	case MicroOp::AddressLo:
+		abs_address = read(PC++);
+		break;
+
+	case MicroOp::ZeroPageX:
+		read(abs_address);
+		abs_address = (abs_address + X) & 0x00FF;
+		break;
+
+	case MicroOp::ZeroPageY:
+		read(abs_address);
+		abs_address = (abs_address + Y) & 0x00FF;
+		break;
+
+	case MicroOp::AddressHi:
+		abs_address |= read(PC++) << 8;
+		break;
+
+	case MicroOp::AddressHiX:
+		micro_base = abs_address | (read(PC++) << 8);
+		abs_address = micro_base + X;
+		break;
+
+	case MicroOp::AddressHiY:
+		micro_base = abs_address | (read(PC++) << 8);
+		abs_address = micro_base + Y;
+		break;
+
+	case MicroOp::Pointer:
+		micro_base = read(PC++);
+		break;
+
+	case MicroOp::PointerX:
+		read(micro_base);
+		micro_base = (micro_base + X) & 0x00FF;
+		break;
+
+	case MicroOp::PointerLo:
+		abs_address = read(micro_base);
+		break;
+
+	case MicroOp::PointerHi:
+		abs_address |= read((micro_base + 1) & 0x00FF) << 8;
+		break;
+
+	case MicroOp::PointerHiY:
+		micro_base = abs_address | (read((micro_base + 1) & 0x00FF) << 8);
+		abs_address = micro_base + Y;
+		break;
+
+	case MicroOp::IndexFix:
+		read((micro_base & 0xFF00) | (abs_address & 0x00FF));
+		break;
+
+	case MicroOp::IndexRead:
+		if ((micro_base & 0xFF00) == (abs_address & 0xFF00))
+		{
+			fetched = read(abs_address);
+			execute();
+		}
+		else
+		{
+			read((micro_base & 0xFF00) | (abs_address & 0x00FF));
+			micro_crossed = true;
+			++cycles;
+		}
+		break;
+
+	case MicroOp::Read:
+	case MicroOp::Modify:
+		fetched = read(abs_address);
+		if (op == MicroOp::Read)
+			execute();
+		break;
+
+	case MicroOp::Write:
+	case MicroOp::ModifyOp:
+	case MicroOp::Operation:
+		execute();
+		break;
+
+	case MicroOp::ModifyWrite:
+		write(abs_address, fetched);
+		break;
+
+	case MicroOp::Stack:
+		read(0x0100 + SP);
+		break;
+
+	case MicroOp::PushPCH:
+		write(0x0100 + SP--, (PC >> 8) & 0xFF);
+		break;
+
+	case MicroOp::PushPCL:
+		write(0x0100 + SP--, PC & 0xFF);
+		break;
+
+	case MicroOp::PushBreak:
+		write(0x0100 + SP--, P | B | U);
+		setFlagStatus(I, true);
+		setFlagStatus(B, false);
+		break;
+
+	case MicroOp::VectorLo:
+		abs_address = read(0xFFFE);
+		break;
+
+	case MicroOp::VectorHi:
+		PC = (read(0xFFFF) << 8) | abs_address;
+		break;
+
+	case MicroOp::JumpHi:
+		PC = (read(PC) << 8) | abs_address;
+		break;
+
+	case MicroOp::IndirectLo:
+		micro_base = read(abs_address);
+		break;
+
+	case MicroOp::IndirectHi:
+		// Same page wrapping bug as IND
+		PC = (read((abs_address & 0xFF00) | ((abs_address + 1) & 0x00FF)) << 8) | micro_base;
+		break;
+
+	case MicroOp::PullP:
+		P = read(0x0100 + ++SP);
+		setFlagStatus(B, false);
+		setFlagStatus(U, true);
+		break;
+
+	case MicroOp::PullPCL:
+		PC = (PC & 0xFF00) | read(0x0100 + ++SP);
+		break;
+
+	case MicroOp::PullPCH:
+		PC = (PC & 0x00FF) | (read(0x0100 + ++SP) << 8);
+		break;
+
+	case MicroOp::Return:
+		read(PC++);
+		break;
+
+	case MicroOp::Branch:
+		rel_address = read(PC++);
+		if (rel_address & 0x80)
+			rel_address |= 0xFF00;
+
+		micro_base = PC;
+		execute();
+		break;
+
+	case MicroOp::BranchTaken:
+		read(micro_base);
+		break;
+
+	case MicroOp::BranchFix:
+		read((micro_base & 0xFF00) | (PC & 0x00FF));
+		break;
+	}
+}
+
+#endif
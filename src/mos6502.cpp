@@ -1,170 +1,444 @@
-///
-/// Implementation of main processor's functionalities
-/// 
-
-#include <functional>
-#include <cassert>
-
-#include "../mos6502.h"
-
-
-// Filling the opcodes lookup array
-std::array<mos6502::Instruction, 256> mos6502::lookup {
-/*						   0										 1										   2										 3										   4										 5										   6									     7										   8									     9										   A										 B										   C										 D										   E										 F						*/
-/* 0 */{{"BRK", &mos6502::BRK, &mos6502::IMP, 7}, {"ORA", &mos6502::ORA, &mos6502::IXD, 6}, {"KIL", &mos6502::KIL, &mos6502::IMP, 2}, {"SLO", &mos6502::SLO, &mos6502::IXD, 8}, {"NOP", &mos6502::NOP, &mos6502::ZP0, 3}, {"ORA", &mos6502::ORA, &mos6502::ZP0, 3}, {"ASL", &mos6502::ASL, &mos6502::ZP0, 5}, {"SLO", &mos6502::SLO, &mos6502::ZP0, 5}, {"PHP", &mos6502::PHP, &mos6502::IMP, 3}, {"ORA", &mos6502::ORA, &mos6502::IMM, 2}, {"ASL", &mos6502::ASL, &mos6502::ACC, 2}, {"ANC", &mos6502::ANC, &mos6502::IMM, 2}, {"NOP", &mos6502::NOP, &mos6502::ABS, 4}, {"ORA", &mos6502::ORA, &mos6502::ABS, 4}, {"ASL", &mos6502::ASL, &mos6502::ABS, 6}, {"SLO", &mos6502::SLO, &mos6502::ABS, 6},
-/* 1 */	{"BPL", &mos6502::BPL, &mos6502::REL, 2}, {"ORA", &mos6502::ORA, &mos6502::IYD, 5}, {"KIL", &mos6502::KIL, &mos6502::IMP, 2}, {"SLO", &mos6502::SLO, &mos6502::IYD, 8}, {"NOP", &mos6502::NOP, &mos6502::ZPX, 4}, {"ORA", &mos6502::ORA, &mos6502::ZPX, 4}, {"ASL", &mos6502::ASL, &mos6502::ZPX, 6}, {"SLO", &mos6502::SLO, &mos6502::ZPX, 6}, {"CLC", &mos6502::CLC, &mos6502::IMP, 2}, {"ORA", &mos6502::ORA, &mos6502::ABY, 4}, {"NOP", &mos6502::NOP, &mos6502::IMP, 2}, {"SLO", &mos6502::SLO, &mos6502::ABY, 7}, {"NOP", &mos6502::NOP, &mos6502::ABX, 4}, {"ORA", &mos6502::ORA, &mos6502::ABX, 4}, {"ASL", &mos6502::ASL, &mos6502::ABX, 7}, {"SLO", &mos6502::SLO, &mos6502::ABX, 7},
-/* 2 */	{"JSR", &mos6502::JSR, &mos6502::ABS, 6}, {"AND", &mos6502::AND, &mos6502::IXD, 6}, {"KIL", &mos6502::KIL, &mos6502::IMP, 2}, {"RLA", &mos6502::RLA, &mos6502::IXD, 8}, {"BIT", &mos6502::BIT, &mos6502::ZP0, 3}, {"AND", &mos6502::AND, &mos6502::ZP0, 3}, {"ROL", &mos6502::ROL, &mos6502::ZP0, 5}, {"RLA", &mos6502::RLA, &mos6502::ZP0, 5}, {"PLP", &mos6502::PLP, &mos6502::IMP, 4}, {"AND", &mos6502::AND, &mos6502::IMM, 2}, {"ROL", &mos6502::ROL, &mos6502::ACC, 2}, {"ANC", &mos6502::ANC, &mos6502::IMM, 2}, {"BIT", &mos6502::BIT, &mos6502::ABS, 4}, {"AND", &mos6502::AND, &mos6502::ABS, 4}, {"ROL", &mos6502::ROL, &mos6502::ABS, 6}, {"RLA", &mos6502::RLA, &mos6502::ABS, 6},
-/* 3 */	{"BMI", &mos6502::BMI, &mos6502::REL, 2}, {"AND", &mos6502::AND, &mos6502::IYD, 5}, {"KIL", &mos6502::KIL, &mos6502::IMP, 2}, {"RLA", &mos6502::RLA, &mos6502::IYD, 8}, {"NOP", &mos6502::NOP, &mos6502::ZPX, 4}, {"AND", &mos6502::AND, &mos6502::ZPX, 4}, {"ROL", &mos6502::ROL, &mos6502::ZPX, 6}, {"RLA", &mos6502::RLA, &mos6502::ZPX, 6}, {"SEC", &mos6502::SEC, &mos6502::IMP, 2}, {"AND", &mos6502::AND, &mos6502::ABY, 4}, {"NOP", &mos6502::NOP, &mos6502::IMP, 2}, {"RLA", &mos6502::RLA, &mos6502::ABY, 7}, {"NOP", &mos6502::NOP, &mos6502::ABX, 4}, {"AND", &mos6502::AND, &mos6502::ABX, 4}, {"ROL", &mos6502::ROL, &mos6502::ABX, 7}, {"RLA", &mos6502::RLA, &mos6502::ABX, 7},
-/* 4 */	{"RTI", &mos6502::RTI, &mos6502::IMP, 6}, {"EOR", &mos6502::EOR, &mos6502::IXD, 6}, {"KIL", &mos6502::KIL, &mos6502::IMP, 2}, {"SRE", &mos6502::SRE, &mos6502::IXD, 8}, {"NOP", &mos6502::NOP, &mos6502::ZP0, 3}, {"EOR", &mos6502::EOR, &mos6502::ZP0, 3}, {"LSR", &mos6502::LSR, &mos6502::ZP0, 5}, {"SRE", &mos6502::SRE, &mos6502::ZP0, 5}, {"PHA", &mos6502::PHA, &mos6502::IMP, 3}, {"EOR", &mos6502::EOR, &mos6502::IMM, 2}, {"LSR", &mos6502::LSR, &mos6502::ACC, 2}, {"ASR", &mos6502::ASR, &mos6502::IMM, 2}, {"JMP", &mos6502::JMP, &mos6502::ABS, 3}, {"EOR", &mos6502::EOR, &mos6502::ABS, 4}, {"LSR", &mos6502::LSR, &mos6502::ABS, 6}, {"SRE", &mos6502::SRE, &mos6502::ABS, 6},
-/* 5 */	{"BVC", &mos6502::BVC, &mos6502::REL, 2}, {"EOR", &mos6502::EOR, &mos6502::IYD, 5}, {"KIL", &mos6502::KIL, &mos6502::IMP, 2}, {"SRE", &mos6502::SRE, &mos6502::IYD, 8}, {"NOP", &mos6502::NOP, &mos6502::ZPX, 4}, {"EOR", &mos6502::EOR, &mos6502::ZPX, 4}, {"LSR", &mos6502::LSR, &mos6502::ZPX, 6}, {"SRE", &mos6502::SRE, &mos6502::ZPX, 6}, {"CLI", &mos6502::CLI, &mos6502::IMP, 2}, {"EOR", &mos6502::EOR, &mos6502::ABY, 4}, {"NOP", &mos6502::NOP, &mos6502::IMP, 2}, {"SRE", &mos6502::SRE, &mos6502::ABY, 7}, {"NOP", &mos6502::NOP, &mos6502::ABX, 4}, {"EOR", &mos6502::EOR, &mos6502::ABX, 4}, {"LSR", &mos6502::LSR, &mos6502::ABX, 7}, {"SRE", &mos6502::SRE, &mos6502::ABX, 7},
-/* 6 */	{"RTS", &mos6502::RTS, &mos6502::IMP, 6}, {"ADC", &mos6502::ADC, &mos6502::IXD, 6}, {"KIL", &mos6502::KIL, &mos6502::IMP, 2}, {"RRA", &mos6502::RRA, &mos6502::IXD, 8}, {"NOP", &mos6502::NOP, &mos6502::ZP0, 3}, {"ADC", &mos6502::ADC, &mos6502::ZP0, 3}, {"ROR", &mos6502::ROR, &mos6502::ZP0, 5}, {"RRA", &mos6502::RRA, &mos6502::ZP0, 5}, {"PLA", &mos6502::PLA, &mos6502::IMP, 4}, {"ADC", &mos6502::ADC, &mos6502::IMM, 2}, {"ROR", &mos6502::ROR, &mos6502::ACC, 2}, {"ARR", &mos6502::ARR, &mos6502::IMM, 2}, {"JMP", &mos6502::JMP, &mos6502::IND, 5}, {"ADC", &mos6502::ADC, &mos6502::ABS, 4}, {"ROR", &mos6502::ROR, &mos6502::ABS, 6}, {"RRA", &mos6502::RRA, &mos6502::ABS, 6},
-/* 7 */	{"BVS", &mos6502::BVS, &mos6502::REL, 2}, {"ADC", &mos6502::ADC, &mos6502::IYD, 5}, {"KIL", &mos6502::KIL, &mos6502::IMP, 2}, {"RRA", &mos6502::RRA, &mos6502::IYD, 8}, {"NOP", &mos6502::NOP, &mos6502::ZPX, 4}, {"ADC", &mos6502::ADC, &mos6502::ZPX, 4}, {"ROR", &mos6502::ROR, &mos6502::ZPX, 6}, {"RRA", &mos6502::RRA, &mos6502::ZPX, 6}, {"SEI", &mos6502::SEI, &mos6502::IMP, 2}, {"ADC", &mos6502::ADC, &mos6502::ABY, 4}, {"NOP", &mos6502::NOP, &mos6502::IMP, 2}, {"RRA", &mos6502::RRA, &mos6502::ABY, 7}, {"NOP", &mos6502::NOP, &mos6502::ABX, 4}, {"ADC", &mos6502::ADC, &mos6502::ABX, 4}, {"ROR", &mos6502::ROR, &mos6502::ABX, 7}, {"RRA", &mos6502::RRA, &mos6502::ABX, 7},
-/* 8 */	{"NOP", &mos6502::NOP, &mos6502::IMM, 2}, {"STA", &mos6502::STA, &mos6502::IXD, 6}, {"KIL", &mos6502::KIL, &mos6502::IMP, 2}, {"AAX", &mos6502::AAX, &mos6502::IXD, 6}, {"STY", &mos6502::STY, &mos6502::ZP0, 3}, {"STA", &mos6502::STA, &mos6502::ZP0, 3}, {"STX", &mos6502::STX, &mos6502::ZP0, 3}, {"AAX", &mos6502::AAX, &mos6502::ZP0, 3}, {"DEY", &mos6502::DEY, &mos6502::IMP, 2}, {"NOP", &mos6502::NOP, &mos6502::IMM, 2}, {"TXA", &mos6502::TXA, &mos6502::IMP, 2}, {"XAA", &mos6502::XAA, &mos6502::IMM, 2}, {"STY", &mos6502::STY, &mos6502::ABS, 4}, {"STA", &mos6502::STA, &mos6502::ABS, 4}, {"STX", &mos6502::STX, &mos6502::ABS, 4}, {"AAX", &mos6502::AAX, &mos6502::ABS, 4},
-/* 9 */	{"BCC", &mos6502::BCC, &mos6502::REL, 2}, {"STA", &mos6502::STA, &mos6502::IYD, 6}, {"KIL", &mos6502::KIL, &mos6502::IMP, 2}, {"AXA", &mos6502::AXA, &mos6502::IYD, 6}, {"STY", &mos6502::STY, &mos6502::ZPX, 4}, {"STA", &mos6502::STA, &mos6502::ZPX, 4}, {"STX", &mos6502::STX, &mos6502::ZPY, 4}, {"AAX", &mos6502::AAX, &mos6502::ZPY, 4}, {"TYA", &mos6502::TYA, &mos6502::IMP, 2}, {"STA", &mos6502::STA, &mos6502::ABY, 5}, {"TXS", &mos6502::TXS, &mos6502::IMP, 2}, {"TAS", &mos6502::TAS, &mos6502::ABY, 5}, {"NOP", &mos6502::NOP, &mos6502::IMP, 4}, {"STA", &mos6502::STA, &mos6502::ABX, 5}, {"SXA", &mos6502::SXA, &mos6502::ABY, 5}, {"AXA", &mos6502::AXA, &mos6502::ABY, 5},
-/* A */	{"LDY", &mos6502::LDY, &mos6502::IMM, 2}, {"LDA", &mos6502::LDA, &mos6502::IXD, 6}, {"LDX", &mos6502::LDX, &mos6502::IMM, 2}, {"LAX", &mos6502::LAX, &mos6502::IXD, 6}, {"LDY", &mos6502::LDY, &mos6502::ZP0, 3}, {"LDA", &mos6502::LDA, &mos6502::ZP0, 3}, {"LDX", &mos6502::LDX, &mos6502::ZP0, 3}, {"LAX", &mos6502::LAX, &mos6502::ZP0, 3}, {"TAY", &mos6502::TAY, &mos6502::IMP, 2}, {"LDA", &mos6502::LDA, &mos6502::IMM, 2}, {"TAX", &mos6502::TAX, &mos6502::IMP, 2}, {"ATX", &mos6502::ATX, &mos6502::IMM, 2}, {"LDY", &mos6502::LDY, &mos6502::ABS, 4}, {"LDA", &mos6502::LDA, &mos6502::ABS, 4}, {"LDX", &mos6502::LDX, &mos6502::ABS, 4}, {"LAX", &mos6502::LAX, &mos6502::ABS, 4},
-/* B */	{"BCS", &mos6502::BCS, &mos6502::REL, 2}, {"LDA", &mos6502::LDA, &mos6502::IYD, 5}, {"KIL", &mos6502::KIL, &mos6502::IMM, 2}, {"LAX", &mos6502::LAX, &mos6502::IYD, 5}, {"LDY", &mos6502::LDY, &mos6502::ZPX, 4}, {"LDA", &mos6502::LDA, &mos6502::ZPX, 4}, {"LDX", &mos6502::LDX, &mos6502::ZPY, 4}, {"LAX", &mos6502::LAX, &mos6502::ZPY, 4}, {"CLV", &mos6502::CLV, &mos6502::IMP, 2}, {"LDA", &mos6502::LDA, &mos6502::ABY, 4}, {"TSX", &mos6502::TSX, &mos6502::IMP, 2}, {"LAS", &mos6502::LAS, &mos6502::ABY, 7}, {"LDY", &mos6502::LDY, &mos6502::ABX, 4}, {"LDA", &mos6502::LDA, &mos6502::ABX, 4}, {"LDX", &mos6502::LDX, &mos6502::ABY, 4}, {"LAX", &mos6502::LAX, &mos6502::ABY, 4},
-/* C */	{"CPY", &mos6502::CPY, &mos6502::IMM, 2}, {"CMP", &mos6502::CMP, &mos6502::IXD, 6}, {"NOP", &mos6502::NOP, &mos6502::IMP, 2}, {"DCP", &mos6502::DCP, &mos6502::IXD, 8}, {"CPY", &mos6502::CPY, &mos6502::ZP0, 3}, {"CMP", &mos6502::CMP, &mos6502::ZP0, 3}, {"DEC", &mos6502::DEC, &mos6502::ZP0, 5}, {"DCP", &mos6502::DCP, &mos6502::ZP0, 5}, {"INY", &mos6502::INY, &mos6502::IMP, 2}, {"CMP", &mos6502::CMP, &mos6502::IMM, 2}, {"DEX", &mos6502::DEX, &mos6502::IMP, 2}, {"SAX", &mos6502::SAX, &mos6502::IMM, 2}, {"CPY", &mos6502::CPY, &mos6502::ABS, 4}, {"CMP", &mos6502::CMP, &mos6502::ABS, 4}, {"DEC", &mos6502::DEC, &mos6502::ABS, 6}, {"DCP", &mos6502::DCP, &mos6502::ABS, 6},
-/* D */	{"BNE", &mos6502::BNE, &mos6502::REL, 2}, {"CMP", &mos6502::CMP, &mos6502::IYD, 5}, {"KIL", &mos6502::KIL, &mos6502::IMP, 2}, {"DCP", &mos6502::DCP, &mos6502::IYD, 8}, {"NOP", &mos6502::NOP, &mos6502::ZPX, 4}, {"CMP", &mos6502::CMP, &mos6502::ZPX, 4}, {"DEC", &mos6502::DEC, &mos6502::ZPX, 6}, {"DCP", &mos6502::DCP, &mos6502::ZPX, 6}, {"CLD", &mos6502::CLD, &mos6502::IMP, 2}, {"CMP", &mos6502::CMP, &mos6502::ABY, 4}, {"NOP", &mos6502::NOP, &mos6502::IMP, 2}, {"DCP", &mos6502::DCP, &mos6502::ABY, 7}, {"NOP", &mos6502::NOP, &mos6502::ABX, 4}, {"CMP", &mos6502::CMP, &mos6502::ABX, 4}, {"DEC", &mos6502::DEC, &mos6502::ABX, 7}, {"DCP", &mos6502::DCP, &mos6502::ABX, 7},
-/* E */	{"CPX", &mos6502::CPX, &mos6502::IMM, 2}, {"SBC", &mos6502::SBC, &mos6502::IXD, 6}, {"NOP", &mos6502::NOP, &mos6502::IMM, 2}, {"ISC", &mos6502::ISC, &mos6502::IXD, 8}, {"CPX", &mos6502::CPX, &mos6502::ZP0, 3}, {"SBC", &mos6502::SBC, &mos6502::ZP0, 3}, {"INC", &mos6502::INC, &mos6502::ZP0, 5}, {"ISC", &mos6502::ISC, &mos6502::ZP0, 5}, {"INX", &mos6502::INX, &mos6502::IMP, 2}, {"SBC", &mos6502::SBC, &mos6502::IMM, 2}, {"NOP", &mos6502::NOP, &mos6502::IMP, 2}, {"SBC", &mos6502::SBC, &mos6502::IMM, 2}, {"CPX", &mos6502::CPX, &mos6502::ABS, 4}, {"SBC", &mos6502::SBC, &mos6502::ABS, 4}, {"INC", &mos6502::INC, &mos6502::ABS, 6}, {"ISC", &mos6502::ISC, &mos6502::ABS, 6},
-/* F */	{"BEQ", &mos6502::BEQ, &mos6502::REL, 2}, {"SBC", &mos6502::SBC, &mos6502::IYD, 5}, {"KIL", &mos6502::KIL, &mos6502::IMP, 2}, {"ISC", &mos6502::ISC, &mos6502::IYD, 8}, {"NOP", &mos6502::NOP, &mos6502::ZPX, 4}, {"SBC", &mos6502::SBC, &mos6502::ZPX, 4}, {"INC", &mos6502::INC, &mos6502::ZPX, 6}, {"ISC", &mos6502::ISC, &mos6502::ZPX, 6}, {"SED", &mos6502::SED, &mos6502::IMP, 2}, {"SBC", &mos6502::SBC, &mos6502::ABY, 4}, {"NOP", &mos6502::NOP, &mos6502::IMP, 2}, {"ISC", &mos6502::ISC, &mos6502::ABY, 7}, {"NOP", &mos6502::NOP, &mos6502::ABX, 4}, {"SBC", &mos6502::SBC, &mos6502::ABX, 4}, {"INC", &mos6502::INC, &mos6502::ABX, 7}, {"ISC", &mos6502::ISC, &mos6502::ABX, 7} } 
-};
-
-
-mos6502::mos6502(Bus* bus)
-	: bus{bus}
-{ }
-
-
-bool mos6502::getFlagStatus(Flags flag) const
-{
-	return P & flag;
-}
-
-
-void mos6502::setFlagStatus(Flags flag, bool set) 
-{
-	if (set) 
-		P |= flag;
-	else 
-		P &= ~flag;
-}
-
-
-// A = X = Y = 0, P = %00100100, SP = 0xFD, PC = {FFFD} << 8 | {FFFC}
-// Takes 7 cycles 
-void mos6502::reset() 
-{
-	A  = 0x00;
-	X  = 0x00;
-	Y  = 0x00;
-	P  = 0x00 | U | I;
-	SP = 0xFD;
-
-	uint16_t lo = read(0xFFFC);
-	uint16_t hi = read(0xFFFD);
-	PC = (hi << 8) | lo;
-
-	abs_address = 0;
-	rel_address = 0;
-	
-	cycles = 7;
-}
-
-
-// Push PC, push P, PC = {FFFF} << 8 | {FFFE}, set I flag
-// Takes 7 cycles 
-void mos6502::irq() 
-{
-	if (!getFlagStatus(I)) 
-	{
-		write(0x0100 + SP--, (PC >> 8) & 0x00FF);
-		write(0x0100 + SP--, PC & 0x00FF);
-
-		setFlagStatus(B, false);
-	
-		write(0x0100 + SP--, P);
-
-		
-		uint16_t lo = read(0xFFFE);
-		uint16_t hi = read(0xFFFF);
-		PC = (hi << 8) | lo;
-
-		setFlagStatus(I, true);
-
-		cycles = 7;
-	}
-}
-
-
-// Push PC, Push P, PC = {FFFB} << 8 | {FFFA}, set I flag
-void mos6502::nmi() 
-{
-	write(0x0100 + SP--, (PC >> 8) & 0x00FF);
-	write(0x0100 + SP--, PC & 0x00FF);
-
-	setFlagStatus(B, false);
-
-	write(0x0100 + SP--, P);
-
-	uint16_t lo = read(0xFFFA);
-	uint16_t hi = read(0xFFFB);
-	PC = (hi << 8) | lo;
-
-	setFlagStatus(I, true);
-
-	cycles = 7;
-}
-
-
-bool mos6502::clock()
-{
-	if (cycles == 0) 
-	{
-		opcode = read(PC++);
-		
-		cycles = lookup[opcode].cycles;
-
-		bool clck1 = std::invoke(lookup[opcode].address_mode, *this);
-
-		fetched = fetch();
-
-		bool clck2 = std::invoke(lookup[opcode].operation, *this);
-
-		// If needed, add another cycle
-		if (clck1 && clck2)
-			++cycles;
-	}
-
-	--cycles; 
-
-	// Increment the number of cycles executed
-	++clock_count;
-
-	return cycles == 0;
-}
-
-
-uint8_t mos6502::fetch() 
-{
-	if (lookup[opcode].address_mode != &mos6502::IMP) 
-	{
-		if (lookup[opcode].address_mode == &mos6502::ACC)
-			return A;
-		
-		return read(abs_address);
-	}
-	else
-		return 0;
-}
-
-
-void mos6502::write(uint16_t address, uint8_t data)
-{
-	bus->write(address, data);
-}
-
-
-uint8_t mos6502::read(uint16_t address) const
-{
-	return bus->read(address, true);
+///
+/// Implementation of main processor's functionalities
+/// 
+
+#include <algorithm>
+#include <functional>
+#include <cassert>
+
+#include "../mos6502.h"
+
+#ifdef MEMORY_STATISTICS
+#include "../heatmap.h"
+#endif
+
+#ifdef HLE_TRAPS
+#include "../traps.h"
+#endif
+
+
+#ifndef CMOS_65C02
+// Filling the opcodes lookup array
+constinit const std::array<mos6502::Instruction, 256> mos6502::lookup {
+/* 0 */{{ Operation::BRK, AddressMode::IMP, 7 }, { Operation::ORA, AddressMode::IXD, 6 }, { Operation::KIL, AddressMode::IMP, 2 }, { Operation::SLO, AddressMode::IXD, 8 }, { Operation::NOP, AddressMode::ZP0, 3 }, { Operation::ORA, AddressMode::ZP0, 3 }, { Operation::ASL, AddressMode::ZP0, 5 }, { Operation::SLO, AddressMode::ZP0, 5 }, { Operation::PHP, AddressMode::IMP, 3 }, { Operation::ORA, AddressMode::IMM, 2 }, { Operation::ASL, AddressMode::ACC, 2 }, { Operation::ANC, AddressMode::IMM, 2 }, { Operation::NOP, AddressMode::ABS, 4 }, { Operation::ORA, AddressMode::ABS, 4 }, { Operation::ASL, AddressMode::ABS, 6 }, { Operation::SLO, AddressMode::ABS, 6 },
+/* 1 */	{ Operation::BPL, AddressMode::REL, 2 }, { Operation::ORA, AddressMode::IYD, 5 }, { Operation::KIL, AddressMode::IMP, 2 }, { Operation::SLO, AddressMode::IYD, 8 }, { Operation::NOP, AddressMode::ZPX, 4 }, { Operation::ORA, AddressMode::ZPX, 4 }, { Operation::ASL, AddressMode::ZPX, 6 }, { Operation::SLO, AddressMode::ZPX, 6 }, { Operation::CLC, AddressMode::IMP, 2 }, { Operation::ORA, AddressMode::ABY, 4 }, { Operation::NOP, AddressMode::IMP, 2 }, { Operation::SLO, AddressMode::ABY, 7 }, { Operation::NOP, AddressMode::ABX, 4 }, { Operation::ORA, AddressMode::ABX, 4 }, { Operation::ASL, AddressMode::ABX, 7 }, { Operation::SLO, AddressMode::ABX, 7 },
+/* 2 */	{ Operation::JSR, AddressMode::ABS, 6 }, { Operation::AND, AddressMode::IXD, 6 }, { Operation::KIL, AddressMode::IMP, 2 }, { Operation::RLA, AddressMode::IXD, 8 }, { Operation::BIT, AddressMode::ZP0, 3 }, { Operation::AND, AddressMode::ZP0, 3 }, { Operation::ROL, AddressMode::ZP0, 5 }, { Operation::RLA, AddressMode::ZP0, 5 }, { Operation::PLP, AddressMode::IMP, 4 }, { Operation::AND, AddressMode::IMM, 2 }, { Operation::ROL, AddressMode::ACC, 2 }, { Operation::ANC, AddressMode::IMM, 2 }, { Operation::BIT, AddressMode::ABS, 4 }, { Operation::AND, AddressMode::ABS, 4 }, { Operation::ROL, AddressMode::ABS, 6 }, { Operation::RLA, AddressMode::ABS, 6 },
+/* 3 */	{ Operation::BMI, AddressMode::REL, 2 }, { Operation::AND, AddressMode::IYD, 5 }, { Operation::KIL, AddressMode::IMP, 2 }, { Operation::RLA, AddressMode::IYD, 8 }, { Operation::NOP, AddressMode::ZPX, 4 }, { Operation::AND, AddressMode::ZPX, 4 }, { Operation::ROL, AddressMode::ZPX, 6 }, { Operation::RLA, AddressMode::ZPX, 6 }, { Operation::SEC, AddressMode::IMP, 2 }, { Operation::AND, AddressMode::ABY, 4 }, { Operation::NOP, AddressMode::IMP, 2 }, { Operation::RLA, AddressMode::ABY, 7 }, { Operation::NOP, AddressMode::ABX, 4 }, { Operation::AND, AddressMode::ABX, 4 }, { Operation::ROL, AddressMode::ABX, 7 }, { Operation::RLA, AddressMode::ABX, 7 },
+/* 4 */	{ Operation::RTI, AddressMode::IMP, 6 }, { Operation::EOR, AddressMode::IXD, 6 }, { Operation::KIL, AddressMode::IMP, 2 }, { Operation::SRE, AddressMode::IXD, 8 }, { Operation::NOP, AddressMode::ZP0, 3 }, { Operation::EOR, AddressMode::ZP0, 3 }, { Operation::LSR, AddressMode::ZP0, 5 }, { Operation::SRE, AddressMode::ZP0, 5 }, { Operation::PHA, AddressMode::IMP, 3 }, { Operation::EOR, AddressMode::IMM, 2 }, { Operation::LSR, AddressMode::ACC, 2 }, { Operation::ASR, AddressMode::IMM, 2 }, { Operation::JMP, AddressMode::ABS, 3 }, { Operation::EOR, AddressMode::ABS, 4 }, { Operation::LSR, AddressMode::ABS, 6 }, { Operation::SRE, AddressMode::ABS, 6 },
+/* 5 */	{ Operation::BVC, AddressMode::REL, 2 }, { Operation::EOR, AddressMode::IYD, 5 }, { Operation::KIL, AddressMode::IMP, 2 }, { Operation::SRE, AddressMode::IYD, 8 }, { Operation::NOP, AddressMode::ZPX, 4 }, { Operation::EOR, AddressMode::ZPX, 4 }, { Operation::LSR, AddressMode::ZPX, 6 }, { Operation::SRE, AddressMode::ZPX, 6 }, { Operation::CLI, AddressMode::IMP, 2 }, { Operation::EOR, AddressMode::ABY, 4 }, { Operation::NOP, AddressMode::IMP, 2 }, { Operation::SRE, AddressMode::ABY, 7 }, { Operation::NOP, AddressMode::ABX, 4 }, { Operation::EOR, AddressMode::ABX, 4 }, { Operation::LSR, AddressMode::ABX, 7 }, { Operation::SRE, AddressMode::ABX, 7 },
+/* 6 */	{ Operation::RTS, AddressMode::IMP, 6 }, { Operation::ADC, AddressMode::IXD, 6 }, { Operation::KIL, AddressMode::IMP, 2 }, { Operation::RRA, AddressMode::IXD, 8 }, { Operation::NOP, AddressMode::ZP0, 3 }, { Operation::ADC, AddressMode::ZP0, 3 }, { Operation::ROR, AddressMode::ZP0, 5 }, { Operation::RRA, AddressMode::ZP0, 5 }, { Operation::PLA, AddressMode::IMP, 4 }, { Operation::ADC, AddressMode::IMM, 2 }, { Operation::ROR, AddressMode::ACC, 2 }, { Operation::ARR, AddressMode::IMM, 2 }, { Operation::JMP, AddressMode::IND, 5 }, { Operation::ADC, AddressMode::ABS, 4 }, { Operation::ROR, AddressMode::ABS, 6 }, { Operation::RRA, AddressMode::ABS, 6 },
+/* 7 */	{ Operation::BVS, AddressMode::REL, 2 }, { Operation::ADC, AddressMode::IYD, 5 }, { Operation::KIL, AddressMode::IMP, 2 }, { Operation::RRA, AddressMode::IYD, 8 }, { Operation::NOP, AddressMode::ZPX, 4 }, { Operation::ADC, AddressMode::ZPX, 4 }, { Operation::ROR, AddressMode::ZPX, 6 }, { Operation::RRA, AddressMode::ZPX, 6 }, { Operation::SEI, AddressMode::IMP, 2 }, { Operation::ADC, AddressMode::ABY, 4 }, { Operation::NOP, AddressMode::IMP, 2 }, { Operation::RRA, AddressMode::ABY, 7 }, { Operation::NOP, AddressMode::ABX, 4 }, { Operation::ADC, AddressMode::ABX, 4 }, { Operation::ROR, AddressMode::ABX, 7 }, { Operation::RRA, AddressMode::ABX, 7 },
+/* 8 */	{ Operation::NOP, AddressMode::IMM, 2 }, { Operation::STA, AddressMode::IXD, 6 }, { Operation::KIL, AddressMode::IMP, 2 }, { Operation::AAX, AddressMode::IXD, 6 }, { Operation::STY, AddressMode::ZP0, 3 }, { Operation::STA, AddressMode::ZP0, 3 }, { Operation::STX, AddressMode::ZP0, 3 }, { Operation::AAX, AddressMode::ZP0, 3 }, { Operation::DEY, AddressMode::IMP, 2 }, { Operation::NOP, AddressMode::IMM, 2 }, { Operation::TXA, AddressMode::IMP, 2 }, { Operation::XAA, AddressMode::IMM, 2 }, { Operation::STY, AddressMode::ABS, 4 }, { Operation::STA, AddressMode::ABS, 4 }, { Operation::STX, AddressMode::ABS, 4 }, { Operation::AAX, AddressMode::ABS, 4 },
+/* 9 */	{ Operation::BCC, AddressMode::REL, 2 }, { Operation::STA, AddressMode::IYD, 6 }, { Operation::KIL, AddressMode::IMP, 2 }, { Operation::AXA, AddressMode::IYD, 6 }, { Operation::STY, AddressMode::ZPX, 4 }, { Operation::STA, AddressMode::ZPX, 4 }, { Operation::STX, AddressMode::ZPY, 4 }, { Operation::AAX, AddressMode::ZPY, 4 }, { Operation::TYA, AddressMode::IMP, 2 }, { Operation::STA, AddressMode::ABY, 5 }, { Operation::TXS, AddressMode::IMP, 2 }, { Operation::TAS, AddressMode::ABY, 5 }, { Operation::NOP, AddressMode::IMP, 4 }, { Operation::STA, AddressMode::ABX, 5 }, { Operation::SXA, AddressMode::ABY, 5 }, { Operation::AXA, AddressMode::ABY, 5 },
+/* A */	{ Operation::LDY, AddressMode::IMM, 2 }, { Operation::LDA, AddressMode::IXD, 6 }, { Operation::LDX, AddressMode::IMM, 2 }, { Operation::LAX, AddressMode::IXD, 6 }, { Operation::LDY, AddressMode::ZP0, 3 }, { Operation::LDA, AddressMode::ZP0, 3 }, { Operation::LDX, AddressMode::ZP0, 3 }, { Operation::LAX, AddressMode::ZP0, 3 }, { Operation::TAY, AddressMode::IMP, 2 }, { Operation::LDA, AddressMode::IMM, 2 }, { Operation::TAX, AddressMode::IMP, 2 }, { Operation::ATX, AddressMode::IMM, 2 }, { Operation::LDY, AddressMode::ABS, 4 }, { Operation::LDA, AddressMode::ABS, 4 }, { Operation::LDX, AddressMode::ABS, 4 }, { Operation::LAX, AddressMode::ABS, 4 },
+/* B */	{ Operation::BCS, AddressMode::REL, 2 }, { Operation::LDA, AddressMode::IYD, 5 }, { Operation::KIL, AddressMode::IMM, 2 }, { Operation::LAX, AddressMode::IYD, 5 }, { Operation::LDY, AddressMode::ZPX, 4 }, { Operation::LDA, AddressMode::ZPX, 4 }, { Operation::LDX, AddressMode::ZPY, 4 }, { Operation::LAX, AddressMode::ZPY, 4 }, { Operation::CLV, AddressMode::IMP, 2 }, { Operation::LDA, AddressMode::ABY, 4 }, { Operation::TSX, AddressMode::IMP, 2 }, { Operation::LAS, AddressMode::ABY, 7 }, { Operation::LDY, AddressMode::ABX, 4 }, { Operation::LDA, AddressMode::ABX, 4 }, { Operation::LDX, AddressMode::ABY, 4 }, { Operation::LAX, AddressMode::ABY, 4 },
+/* C */	{ Operation::CPY, AddressMode::IMM, 2 }, { Operation::CMP, AddressMode::IXD, 6 }, { Operation::NOP, AddressMode::IMP, 2 }, { Operation::DCP, AddressMode::IXD, 8 }, { Operation::CPY, AddressMode::ZP0, 3 }, { Operation::CMP, AddressMode::ZP0, 3 }, { Operation::DEC, AddressMode::ZP0, 5 }, { Operation::DCP, AddressMode::ZP0, 5 }, { Operation::INY, AddressMode::IMP, 2 }, { Operation::CMP, AddressMode::IMM, 2 }, { Operation::DEX, AddressMode::IMP, 2 }, { Operation::SAX, AddressMode::IMM, 2 }, { Operation::CPY, AddressMode::ABS, 4 }, { Operation::CMP, AddressMode::ABS, 4 }, { Operation::DEC, AddressMode::ABS, 6 }, { Operation::DCP, AddressMode::ABS, 6 },
+/* D */	{ Operation::BNE, AddressMode::REL, 2 }, { Operation::CMP, AddressMode::IYD, 5 }, { Operation::KIL, AddressMode::IMP, 2 }, { Operation::DCP, AddressMode::IYD, 8 }, { Operation::NOP, AddressMode::ZPX, 4 }, { Operation::CMP, AddressMode::ZPX, 4 }, { Operation::DEC, AddressMode::ZPX, 6 }, { Operation::DCP, AddressMode::ZPX, 6 }, { Operation::CLD, AddressMode::IMP, 2 }, { Operation::CMP, AddressMode::ABY, 4 }, { Operation::NOP, AddressMode::IMP, 2 }, { Operation::DCP, AddressMode::ABY, 7 }, { Operation::NOP, AddressMode::ABX, 4 }, { Operation::CMP, AddressMode::ABX, 4 }, { Operation::DEC, AddressMode::ABX, 7 }, { Operation::DCP, AddressMode::ABX, 7 },
+/* E */	{ Operation::CPX, AddressMode::IMM, 2 }, { Operation::SBC, AddressMode::IXD, 6 }, { Operation::NOP, AddressMode::IMM, 2 }, { Operation::ISC, AddressMode::IXD, 8 }, { Operation::CPX, AddressMode::ZP0, 3 }, { Operation::SBC, AddressMode::ZP0, 3 }, { Operation::INC, AddressMode::ZP0, 5 }, { Operation::ISC, AddressMode::ZP0, 5 }, { Operation::INX, AddressMode::IMP, 2 }, { Operation::SBC, AddressMode::IMM, 2 }, { Operation::NOP, AddressMode::IMP, 2 }, { Operation::SBC, AddressMode::IMM, 2 }, { Operation::CPX, AddressMode::ABS, 4 }, { Operation::SBC, AddressMode::ABS, 4 }, { Operation::INC, AddressMode::ABS, 6 }, { Operation::ISC, AddressMode::ABS, 6 },
+/* F */	{ Operation::BEQ, AddressMode::REL, 2 }, { Operation::SBC, AddressMode::IYD, 5 }, { Operation::KIL, AddressMode::IMP, 2 }, { Operation::ISC, AddressMode::IYD, 8 }, { Operation::NOP, AddressMode::ZPX, 4 }, { Operation::SBC, AddressMode::ZPX, 4 }, { Operation::INC, AddressMode::ZPX, 6 }, { Operation::ISC, AddressMode::ZPX, 6 }, { Operation::SED, AddressMode::IMP, 2 }, { Operation::SBC, AddressMode::ABY, 4 }, { Operation::NOP, AddressMode::IMP, 2 }, { Operation::ISC, AddressMode::ABY, 7 }, { Operation::NOP, AddressMode::ABX, 4 }, { Operation::SBC, AddressMode::ABX, 4 }, { Operation::INC, AddressMode::ABX, 7 }, { Operation::ISC, AddressMode::ABX, 7 } }
+};
+
+
+// Names of the opcodes, for the disassembler
+constinit const std::array<std::string_view, 256> mos6502::mnemonics {
+/* 0 */	"BRK", "ORA", "KIL", "SLO", "NOP", "ORA", "ASL", "SLO", "PHP", "ORA", "ASL", "ANC", "NOP", "ORA", "ASL", "SLO",
+/* 1 */	"BPL", "ORA", "KIL", "SLO", "NOP", "ORA", "ASL", "SLO", "CLC", "ORA", "NOP", "SLO", "NOP", "ORA", "ASL", "SLO",
+/* 2 */	"JSR", "AND", "KIL", "RLA", "BIT", "AND", "ROL", "RLA", "PLP", "AND", "ROL", "ANC", "BIT", "AND", "ROL", "RLA",
+/* 3 */	"BMI", "AND", "KIL", "RLA", "NOP", "AND", "ROL", "RLA", "SEC", "AND", "NOP", "RLA", "NOP", "AND", "ROL", "RLA",
+/* 4 */	"RTI", "EOR", "KIL", "SRE", "NOP", "EOR", "LSR", "SRE", "PHA", "EOR", "LSR", "ASR", "JMP", "EOR", "LSR", "SRE",
+/* 5 */	"BVC", "EOR", "KIL", "SRE", "NOP", "EOR", "LSR", "SRE", "CLI", "EOR", "NOP", "SRE", "NOP", "EOR", "LSR", "SRE",
+/* 6 */	"RTS", "ADC", "KIL", "RRA", "NOP", "ADC", "ROR", "RRA", "PLA", "ADC", "ROR", "ARR", "JMP", "ADC", "ROR", "RRA",
+/* 7 */	"BVS", "ADC", "KIL", "RRA", "NOP", "ADC", "ROR", "RRA", "SEI", "ADC", "NOP", "RRA", "NOP", "ADC", "ROR", "RRA",
+/* 8 */	"NOP", "STA", "KIL", "AAX", "STY", "STA", "STX", "AAX", "DEY", "NOP", "TXA", "XAA", "STY", "STA", "STX", "AAX",
+/* 9 */	"BCC", "STA", "KIL", "AXA", "STY", "STA", "STX", "AAX", "TYA", "STA", "TXS", "TAS", "NOP", "STA", "SXA", "AXA",
+/* A */	"LDY", "LDA", "LDX", "LAX", "LDY", "LDA", "LDX", "LAX", "TAY", "LDA", "TAX", "ATX", "LDY", "LDA", "LDX", "LAX",
+/* B */	"BCS", "LDA", "KIL", "LAX", "LDY", "LDA", "LDX", "LAX", "CLV", "LDA", "TSX", "LAS", "LDY", "LDA", "LDX", "LAX",
+/* C */	"CPY", "CMP", "NOP", "DCP", "CPY", "CMP", "DEC", "DCP", "INY", "CMP", "DEX", "SAX", "CPY", "CMP", "DEC", "DCP",
+/* D */	"BNE", "CMP", "KIL", "DCP", "NOP", "CMP", "DEC", "DCP", "CLD", "CMP", "NOP", "DCP", "NOP", "CMP", "DEC", "DCP",
+/* E */	"CPX", "SBC", "NOP", "ISC", "CPX", "SBC", "INC", "ISC", "INX", "SBC", "NOP", "SBC", "CPX", "SBC", "INC", "ISC",
+/* F */	"BEQ", "SBC", "KIL", "ISC", "NOP", "SBC", "INC", "ISC", "SED", "SBC", "NOP", "ISC", "NOP", "SBC", "INC", "ISC"
+};
+#endif
+
+
+// Routines of the instructions, in the order of Operation
+constinit const std::array<bool (mos6502::*)(), static_cast<std::size_t>(mos6502::Operation::count)> mos6502::operations {
+	&mos6502::ADC, &mos6502::AND, &mos6502::ASL, &mos6502::BCC, &mos6502::BCS, &mos6502::BEQ, &mos6502::BIT, &mos6502::BMI,
+	&mos6502::BNE, &mos6502::BPL, &mos6502::BRK, &mos6502::BVC, &mos6502::BVS, &mos6502::CLC, &mos6502::CLD, &mos6502::CLI,
+	&mos6502::CLV, &mos6502::CMP, &mos6502::CPX, &mos6502::CPY, &mos6502::DEC, &mos6502::DEX, &mos6502::DEY, &mos6502::EOR,
+	&mos6502::INC, &mos6502::INX, &mos6502::INY, &mos6502::JMP, &mos6502::JSR, &mos6502::LDA, &mos6502::LDX, &mos6502::LDY,
+	&mos6502::LSR, &mos6502::NOP, &mos6502::ORA, &mos6502::PHA, &mos6502::PHP, &mos6502::PLA, &mos6502::PLP, &mos6502::ROL,
+	&mos6502::ROR, &mos6502::RTI, &mos6502::RTS, &mos6502::SBC, &mos6502::SEC, &mos6502::SED, &mos6502::SEI, &mos6502::STA,
+	&mos6502::STX, &mos6502::STY, &mos6502::TAX, &mos6502::TAY, &mos6502::TSX, &mos6502::TXA, &mos6502::TXS, &mos6502::TYA,
+	&mos6502::AAX, &mos6502::ANC, &mos6502::ARR, &mos6502::ASR, &mos6502::ATX, &mos6502::AXA, &mos6502::DCP, &mos6502::ISC,
+	&mos6502::KIL, &mos6502::LAS, &mos6502::LAX, &mos6502::RLA, &mos6502::RRA, &mos6502::SAX, &mos6502::SLO, &mos6502::SRE,
+	&mos6502::SXA, &mos6502::SYA, &mos6502::TAS, &mos6502::XAA,
+#ifdef CMOS_65C02
+	&mos6502::BBR, &mos6502::BBS, &mos6502::BRA, &mos6502::PHX, &mos6502::PHY, &mos6502::PLX, &mos6502::PLY, &mos6502::RMB,
+	&mos6502::SMB, &mos6502::STP, &mos6502::STZ, &mos6502::TRB, &mos6502::TSB, &mos6502::WAI,
+#endif
+};
+
+
+// Routines of the addressing modes, in the order of AddressMode
+constinit const std::array<bool (mos6502::*)(), 16> mos6502::address_modes {
+	&mos6502::IMP, &mos6502::ACC, &mos6502::IMM, &mos6502::ZP0, &mos6502::ZPX, &mos6502::ZPY, &mos6502::ABS, &mos6502::ABX,
+	&mos6502::ABY, &mos6502::IND, &mos6502::IXD, &mos6502::IYD, &mos6502::REL,
+#ifdef CMOS_65C02
+	&mos6502::ZPI, &mos6502::IAX, &mos6502::ZPR
+#endif
+};
+
+
+
+mos6502::mos6502(Bus* bus)
+	: bus{bus}
+{ }
+
+
+bool mos6502::getFlagStatus(Flags flag) const
+{
+	return P & flag;
+}
+
+
+void mos6502::setFlagStatus(Flags flag, bool set) 
+{
+	if (set) 
+		P |= flag;
+	else 
+		P &= ~flag;
+}
+
+
+// A = X = Y = 0, P = %00100100, SP = 0xFD, PC = {FFFD} << 8 | {FFFC}
+// Takes 7 cycles 
+void mos6502::reset() 
+{
+	A  = 0x00;
+	X  = 0x00;
+	Y  = 0x00;
+	P  = 0x00 | U | I;
+	SP = 0xFD;
+
+	uint16_t lo = read(0xFFFC);
+	uint16_t hi = read(0xFFFD);
+	PC = (hi << 8) | lo;
+
+	abs_address = 0;
+	rel_address = 0;
+
+	halt = Halt::None;
+#ifdef CMOS_65C02
+	waiting = false;
+#else
+	// An instruction in progress in tick() is abandoned
+	micro_cycle = 0;
+#endif
+
+#ifdef HLE_TRAPS
+	pending_count = 0;
+#endif
+	
+	cycles = 7;
+}
+
+
+// Push PC, push P, PC = {FFFF} << 8 | {FFFE}, set I flag
+// Takes 7 cycles 
+void mos6502::irq() 
+{
+	if (locked())
+		return;
+
+#ifndef CMOS_65C02
+	completeInstruction();
+#endif
+
+#ifdef CMOS_65C02
+	// WAI is resumed even when the interrupt is masked
+	waiting = false;
+#endif
+
+	if (!getFlagStatus(I)) 
+	{
+		write(0x0100 + SP--, (PC >> 8) & 0x00FF);
+		write(0x0100 + SP--, PC & 0x00FF);
+
+		setFlagStatus(B, false);
+	
+		write(0x0100 + SP--, P);
+
+		
+		uint16_t lo = read(0xFFFE);
+		uint16_t hi = read(0xFFFF);
+		PC = (hi << 8) | lo;
+
+		setFlagStatus(I, true);
+#ifdef CMOS_65C02
+		setFlagStatus(D, false);
+#endif
+
+		// The handler can leave a loop
+		halt = Halt::None;
+
+		cycles = 7;
+	}
+}
+
+
+// Push PC, Push P, PC = {FFFB} << 8 | {FFFA}, set I flag
+void mos6502::nmi() 
+{
+	if (locked())
+		return;
+
+#ifndef CMOS_65C02
+	completeInstruction();
+#endif
+
+#ifdef CMOS_65C02
+	waiting = false;
+#endif
+
+	write(0x0100 + SP--, (PC >> 8) & 0x00FF);
+	write(0x0100 + SP--, PC & 0x00FF);
+
+	setFlagStatus(B, false);
+
+	write(0x0100 + SP--, P);
+
+	uint16_t lo = read(0xFFFA);
+	uint16_t hi = read(0xFFFB);
+	PC = (hi << 8) | lo;
+
+	setFlagStatus(I, true);
+#ifdef CMOS_65C02
+	setFlagStatus(D, false);
+#endif
+
+	halt = Halt::None;
+
+	cycles = 7;
+}
+
+
+bool mos6502::clock()
+{
+	if (cycles == 0)
+		updateDevices();
+	if (cycles == 0) 
+		execute();
+
+	--cycles; 
+
+	// Increment the number of cycles executed
+	++clock_count;
+
+	return cycles == 0;
+}
+
+
+uint8_t mos6502::step()
+{
+	finish();
+	updateDevices();
+	finish();
+
+	// Nothing runs until an interrupt or reset()
+	if (halt != Halt::None)
+		return 0;
+	execute();
+
+	uint8_t executed = cycles;
+	clock_count += cycles;
+	cycles = 0;
+
+	return executed;
+}
+
+
+void mos6502::finish()
+{
+	clock_count += cycles;
+	cycles = 0;
+}
+
+
+void mos6502::execute()
+{
+	// A halted CPU doesn't fetch instructions, the clock goes on
+	if (halt != Halt::None)
+	{
+		cycles = 1;
+		return;
+	}
+
+#ifdef CMOS_65C02
+	// Same for WAI
+	if (waiting)
+	{
+		cycles = 1;
+		return;
+	}
+#endif
+
+#ifdef HLE_TRAPS
+	if (traps && traps->test(PC))
+	{
+		trap();
+		return;
+	}
+#endif
+
+#ifdef MEMORY_STATISTICS
+	if (heatmap)
+		++heatmap->executes[PC];
+#endif
+
+	uint16_t address = PC;
+	opcode = read(PC++);
+	
+	const Instruction& instruction = lookup[opcode];
+	cycles = instruction.cycles;
+
+	bool clck1 = std::invoke(address_modes[static_cast<uint8_t>(instruction.mode)], *this);
+
+	fetched = fetch();
+
+	bool clck2 = std::invoke(operations[static_cast<uint8_t>(instruction.operation)], *this);
+
+	// If needed, add another cycle
+	if (clck1 && clck2)
+		++cycles;
+
+	if (halt_on_loops)
+		detectLoop(address);
+
+#ifdef OPCODE_STATISTICS
+	countInstruction(cycles, clck1 && clck2);
+#endif
+}
+
+
+void mos6502::detectLoop(uint16_t address)
+{
+	if (PC != address || halt != Halt::None)
+		return;
+
+	// Other instructions that don't move PC (RTS, RTI, BRK) change the stack
+	if (lookup[opcode].mode == AddressMode::REL)
+		halt = Halt::BranchToSelf;
+	else if (lookup[opcode].operation == Operation::JMP)
+		halt = Halt::JumpToSelf;
+}
+
+
+#ifdef HLE_TRAPS
+void mos6502::trap()
+{
+	// An interrupt can be taken between the parts of a long trap, RTI resumes it. A trap called by the
+	// interrupt handler runs its own handler
+	uint32_t remaining;
+	if (pending_count > 0 && pending_traps[pending_count - 1].address == PC && pending_traps[pending_count - 1].stack == SP)
+	{
+		--pending_count;
+		remaining = pending_traps[pending_count].cycles;
+	}
+	else
+		remaining = std::max(traps->call(PC, *this), 1u);
+
+	cycles = static_cast<uint8_t>(std::min(remaining, 255u));
+	remaining -= cycles;
+
+	// Without room for another level the trap is cut to its first part
+	if (remaining > 0 && pending_count < pending_traps.size())
+	{
+		pending_traps[pending_count++] = { PC, SP, remaining };
+		opcode = 0xEA;
+		return;
+	}
+
+	// Same as RTS
+	uint16_t lo = read(0x0100 + ++SP);
+	uint16_t hi = read(0x0100 + ++SP);
+	PC = ((hi << 8) | lo) + 1;
+
+	opcode = 0x60;
+}
+#endif
+
+
+#ifdef OPCODE_STATISTICS
+void mos6502::countInstruction(uint8_t instruction_cycles, bool page_crossed)
+{
+	++statistics.executions[opcode];
+	statistics.cycles[opcode] += instruction_cycles;
+	statistics.page_crosses[opcode] += page_crossed;
+	// Longer instructions (a trap, a 65C02 NOP) share the last bucket
+	++statistics.cycle_histogram[std::min<std::size_t>(instruction_cycles, statistics.cycle_histogram.size() - 1)];
+
+	// Branches (BBR and BBS too) add one cycle when taken and another one when the target is in another page
+	if (lookup[opcode].mode == AddressMode::REL || lookup[opcode].mode == AddressMode::ZPR)
+	{
+		uint8_t extra = instruction_cycles - lookup[opcode].cycles;
+
+		statistics.branches_taken[opcode] += extra >= 1;
+		statistics.branch_page_crosses[opcode] += extra >= 2;
+	}
+}
+#endif
+
+
+uint8_t mos6502::fetch() 
+{
+	const Instruction& instruction = lookup[opcode];
+
+	// Stores, jumps and branches don't use the data: reading it could have side effects on a device
+	if (instruction.no_fetch)
+		return 0;
+
+	if (instruction.mode != AddressMode::IMP) 
+	{
+		if (instruction.mode == AddressMode::ACC)
+			return A;
+		
+		return read(abs_address);
+	}
+	else
+		return 0;
+}
+
+
+void mos6502::write(uint16_t address, uint8_t data)
+{
+#ifdef MEMORY_STATISTICS
+	if (heatmap)
+		++heatmap->writes[address];
+#endif
+
+#ifdef MEMORY_HOOKS
+	if (access_count < max_accesses)
+		accesses[access_count++] = { address, data, true };
+#endif
+
+	bus->write(address, data);
+}
+
+
+uint8_t mos6502::read(uint16_t address) const
+{
+#ifdef MEMORY_STATISTICS
+	if (heatmap)
+		++heatmap->reads[address];
+#endif
+
+	uint8_t data = bus->read(address, false);
+
+#ifdef MEMORY_HOOKS
+	if (access_count < max_accesses)
+		accesses[access_count++] = { address, data, false };
+#endif
+
+	return data;
 }
\ No newline at end of file
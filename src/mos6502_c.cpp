@@ -0,0 +1,380 @@
+///
+/// Implementation of the C interface
+///
+
+#include <cstdint>
+#include <algorithm>
+#include <new>
+#include <vector>
+
+#include "../mos6502_c.h"
+#include "../mos6502.h"
+
+
+namespace
+{
+	// Bounded queue that drops its oldest items when full
+	template <typename T>
+	class Ring
+	{
+	public:
+		// Throws std::bad_alloc
+		void resize(std::size_t capacity)
+		{
+			items.assign(capacity, T{ });
+			first = 0;
+			count = 0;
+		}
+
+		void push(const T& item)
+		{
+			if (items.empty())
+				return;
+
+			if (count == items.size())
+			{
+				first = next(first);
+				--count;
+				++dropped;
+			}
+
+			std::size_t last = first + count;
+			items[last < items.size() ? last : last - items.size()] = item;
+			++count;
+		}
+
+		std::size_t drain(T* out, std::size_t max)
+		{
+			std::size_t moved = std::min(max, count);
+
+			for (std::size_t i = 0; i < moved; ++i)
+			{
+				out[i] = items[first];
+				first = next(first);
+			}
+
+			count -= moved;
+			return moved;
+		}
+
+		bool enabled() const { return !items.empty(); }
+
+		uint64_t dropped = 0;
+
+	private:
+		std::size_t next(std::size_t index) const { return index + 1 == items.size() ? 0 : index + 1; }
+
+		std::vector<T> items;
+		std::size_t first = 0;
+		std::size_t count = 0;
+	};
+}
+
+
+struct mos6502_c_machine
+{
+	mos6502_c_machine()
+	{
+		bus.cpu = &cpu;
+		events.resize(1024);
+	}
+
+	void event(uint8_t kind)
+	{
+		events.push({ cpu.clock_count, cpu.PC, kind, { } });
+	}
+
+	Bus		bus;
+	mos6502 cpu{ &bus };
+
+	bool irq_line	 = false;
+	bool nmi_pending = false;
+
+	Ring<mos6502_c_trace_record> trace;
+	Ring<mos6502_c_event>		 events;
+};
+
+
+namespace
+{
+	// Fills the trace and the events of the machine during mos6502_c_run()
+	class RecordHooks : public NoHooks
+	{
+	public:
+		explicit RecordHooks(mos6502_c_machine& machine)
+			: machine{ machine }
+		{ }
+
+		void beforeInstruction(const mos6502& cpu)
+		{
+			if (!tracing)
+				return;
+
+			mos6502::Disassembly instruction = cpu.decode(cpu.PC);
+
+			machine.trace.push({ cpu.clock_count, cpu.PC, instruction.opcode, { instruction.operands[0], instruction.operands[1] },
+								 cpu.A, cpu.X, cpu.Y, cpu.P, cpu.SP, { } });
+		}
+
+		void interrupt([[maybe_unused]] const mos6502& cpu, uint16_t vector)
+		{
+			machine.event(vector == 0xFFFA ? MOS6502_C_EVENT_NMI : MOS6502_C_EVENT_IRQ);
+		}
+
+		bool tracing = false;
+
+	private:
+		mos6502_c_machine& machine;
+	};
+}
+
+
+uint32_t mos6502_c_abi_version(void)
+{
+	return MOS6502_C_ABI_VERSION;
+}
+
+
+mos6502_c_machine* mos6502_c_create(void)
+{
+	try
+	{
+		return new mos6502_c_machine;
+	}
+	catch (const std::bad_alloc&)
+	{
+		return nullptr;
+	}
+}
+
+
+void mos6502_c_destroy(mos6502_c_machine* machine)
+{
+	delete machine;
+}
+
+
+uint64_t mos6502_c_run(mos6502_c_machine* machine, uint64_t cycles)
+{
+	if (!machine)
+		return 0;
+
+	mos6502& cpu = machine->cpu;
+	uint64_t start = cpu.clock_count;
+
+	RecordHooks hooks{ *machine };
+	hooks.tracing = machine->trace.enabled();
+
+	for (;;)
+	{
+		// Cycles left by reset() or by an interrupt count toward the limit
+		cpu.finish();
+
+		if (cpu.clock_count - start >= cycles)
+			break;
+
+		// Interrupts can leave a loop, not a JAM or STP
+		mos6502::Halt halt = cpu.halted();
+		bool locked = halt == mos6502::Halt::Jam || halt == mos6502::Halt::Stop;
+
+		if (machine->nmi_pending && !locked)
+		{
+			machine->nmi_pending = false;
+			cpu.nmi(hooks);
+		}
+		else if (machine->irq_line && !(cpu.P & mos6502::I) && !locked)
+			cpu.irq(hooks);
+		else if (halt != mos6502::Halt::None)
+			break;
+		else
+		{
+			cpu.step(hooks);
+
+			if (cpu.halted() != mos6502::Halt::None)
+				machine->event(MOS6502_C_EVENT_HALT);
+		}
+	}
+
+	return cpu.clock_count - start;
+}
+
+
+int mos6502_c_halted(const mos6502_c_machine* machine)
+{
+	if (!machine)
+		return MOS6502_C_ERROR_ARGUMENT;
+
+	return static_cast<int>(machine->cpu.halted());
+}
+
+
+int mos6502_c_set_halt_on_loops(mos6502_c_machine* machine, int enabled)
+{
+	if (!machine)
+		return MOS6502_C_ERROR_ARGUMENT;
+
+	machine->cpu.halt_on_loops = enabled != 0;
+	return MOS6502_C_OK;
+}
+
+
+int mos6502_c_reset(mos6502_c_machine* machine)
+{
+	if (!machine)
+		return MOS6502_C_ERROR_ARGUMENT;
+
+	machine->cpu.finish();
+	machine->cpu.reset();
+	machine->nmi_pending = false;
+	machine->event(MOS6502_C_EVENT_RESET);
+
+	return MOS6502_C_OK;
+}
+
+
+int mos6502_c_set_irq(mos6502_c_machine* machine, int level)
+{
+	if (!machine)
+		return MOS6502_C_ERROR_ARGUMENT;
+
+	machine->irq_line = level != 0;
+	return MOS6502_C_OK;
+}
+
+
+int mos6502_c_nmi(mos6502_c_machine* machine)
+{
+	if (!machine)
+		return MOS6502_C_ERROR_ARGUMENT;
+
+	machine->nmi_pending = true;
+	return MOS6502_C_OK;
+}
+
+
+int mos6502_c_get_registers(const mos6502_c_machine* machine, mos6502_c_registers* registers)
+{
+	if (!machine || !registers)
+		return MOS6502_C_ERROR_ARGUMENT;
+
+	const mos6502& cpu = machine->cpu;
+	*registers = { cpu.clock_count, cpu.PC, cpu.A, cpu.X, cpu.Y, cpu.P, cpu.SP, 0 };
+
+	return MOS6502_C_OK;
+}
+
+
+int mos6502_c_set_registers(mos6502_c_machine* machine, const mos6502_c_registers* registers)
+{
+	if (!machine || !registers)
+		return MOS6502_C_ERROR_ARGUMENT;
+
+	mos6502& cpu = machine->cpu;
+
+	// The cycles left by reset() or by an interrupt would be charged after the new counter
+	cpu.finish();
+
+	cpu.clock_count = registers->cycles;
+	cpu.PC = registers->pc;
+	cpu.A  = registers->a;
+	cpu.X  = registers->x;
+	cpu.Y  = registers->y;
+	cpu.P  = registers->p;
+	cpu.SP = registers->sp;
+
+	return MOS6502_C_OK;
+}
+
+
+int mos6502_c_load(mos6502_c_machine* machine, uint16_t address, const uint8_t* data, size_t size)
+{
+	if (!machine || (!data && size != 0))
+		return MOS6502_C_ERROR_ARGUMENT;
+
+	if (size > machine->bus.ram.size() - address)
+		return MOS6502_C_ERROR_RANGE;
+
+	std::copy_n(data, size, machine->bus.ram.begin() + address);
+	return MOS6502_C_OK;
+}
+
+
+int mos6502_c_dump(const mos6502_c_machine* machine, uint16_t address, uint8_t* data, size_t size)
+{
+	if (!machine || (!data && size != 0))
+		return MOS6502_C_ERROR_ARGUMENT;
+
+	if (size > machine->bus.ram.size() - address)
+		return MOS6502_C_ERROR_RANGE;
+
+	std::copy_n(machine->bus.ram.begin() + address, size, data);
+	return MOS6502_C_OK;
+}
+
+
+int mos6502_c_trace_enable(mos6502_c_machine* machine, size_t capacity)
+{
+	if (!machine)
+		return MOS6502_C_ERROR_ARGUMENT;
+
+	try
+	{
+		machine->trace.resize(capacity);
+	}
+	catch (const std::bad_alloc&)
+	{
+		machine->trace.resize(0);
+		return MOS6502_C_ERROR_MEMORY;
+	}
+
+	return MOS6502_C_OK;
+}
+
+
+size_t mos6502_c_trace_drain(mos6502_c_machine* machine, mos6502_c_trace_record* records, size_t count)
+{
+	if (!machine || !records)
+		return 0;
+
+	return machine->trace.drain(records, count);
+}
+
+
+int mos6502_c_events_enable(mos6502_c_machine* machine, size_t capacity)
+{
+	if (!machine)
+		return MOS6502_C_ERROR_ARGUMENT;
+
+	try
+	{
+		machine->events.resize(capacity);
+	}
+	catch (const std::bad_alloc&)
+	{
+		machine->events.resize(0);
+		return MOS6502_C_ERROR_MEMORY;
+	}
+
+	return MOS6502_C_OK;
+}
+
+
+size_t mos6502_c_events_drain(mos6502_c_machine* machine, mos6502_c_event* events, size_t count)
+{
+	if (!machine || !events)
+		return 0;
+
+	return machine->events.drain(events, count);
+}
+
+
+uint64_t mos6502_c_trace_dropped(const mos6502_c_machine* machine)
+{
+	return machine ? machine->trace.dropped : 0;
+}
+
+
+uint64_t mos6502_c_events_dropped(const mos6502_c_machine* machine)
+{
+	return machine ? machine->events.dropped : 0;
+}
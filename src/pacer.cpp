@@ -0,0 +1,120 @@
+///
+/// Implementation of Pacer
+///
+
+#include <cstdint>
+#include <algorithm>
+#include <cerrno>
+#include <cmath>
+#include <stdexcept>
+
+#include <time.h>
+
+#include "../pacer.h"
+
+
+namespace
+{
+	timespec toTimespec(int64_t nanoseconds)
+	{
+		return { static_cast<time_t>(nanoseconds / 1'000'000'000), static_cast<long>(nanoseconds % 1'000'000'000) };
+	}
+}
+
+
+Pacer::Pacer(double frequency, Options options)
+	: options{ options }
+{
+	if (!(frequency > 0.0))
+		throw std::invalid_argument("the frequency must be positive");
+
+	period = 1e9 / frequency;
+
+	if (this->options.burst == 0)
+		this->options.burst = std::max<uint64_t>(1, static_cast<uint64_t>(frequency / 1000.0));
+}
+
+
+void Pacer::start(uint64_t cycle)
+{
+	started = true;
+	epoch = now();
+	base = cycle;
+}
+
+
+void Pacer::wait(uint64_t cycle)
+{
+	if (!started)
+		start(cycle);
+
+	int64_t target = deadline(cycle);
+	int64_t current = now();
+
+	if (current >= target)
+	{
+		++stats.overruns;
+		record(current - target);
+
+		// Too late to catch up, the timebase starts again from here
+		if (current - target > options.max_lateness.count())
+		{
+			++stats.resyncs;
+			epoch = current;
+			base = cycle;
+		}
+
+		return;
+	}
+
+	// Sleeps up to the spinning part, clock_nanosleep is resumed with the same absolute time when interrupted
+	int64_t wake = target - options.spin.count();
+	if (wake > current)
+	{
+		timespec time = toTimespec(wake);
+		while (clock_nanosleep(CLOCK_MONOTONIC, TIMER_ABSTIME, &time, nullptr) == EINTR)
+			;
+	}
+
+	do
+		current = now();
+	while (current < target);
+
+	record(current - target);
+}
+
+
+void Pacer::run(mos6502& cpu, uint64_t cycles)
+{
+	NoHooks hooks;
+	run(cpu, cycles, hooks);
+}
+
+
+int64_t Pacer::deadline(uint64_t cycle) const
+{
+	return epoch + std::llround(static_cast<double>(cycle - base) * period);
+}
+
+
+int64_t Pacer::now()
+{
+	timespec time;
+	clock_gettime(CLOCK_MONOTONIC, &time);
+
+	return int64_t{ time.tv_sec } * 1'000'000'000 + time.tv_nsec;
+}
+
+
+void Pacer::record(int64_t lateness)
+{
+	++stats.bursts;
+	stats.total_lateness += std::chrono::nanoseconds{ lateness };
+	stats.max_lateness = std::max(stats.max_lateness, std::chrono::nanoseconds{ lateness });
+
+	std::size_t bucket = 0;
+	for (int64_t limit = 1000; bucket + 1 < stats.histogram.size() && lateness >= limit; limit *= 10)
+		++bucket;
+
+	++stats.histogram[bucket];
+}
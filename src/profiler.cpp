@@ -0,0 +1,269 @@
+///
+/// Implementation of Profiler
+///
+
+#include <cstdint>
+#include <algorithm>
+#include <cstdio>
+#include <string>
+
+#include "../profiler.h"
+
+
+// JSR, RTS and RTI opcodes
+static constexpr uint8_t JSR = 0x20;
+static constexpr uint8_t RTS = 0x60;
+static constexpr uint8_t RTI = 0x40;
+
+
+// Writes the symbol of the address, or the address itself
+static void writeName(std::ostream& out, uint16_t address, const SymbolTable* symbols)
+{
+	if (symbols)
+	{
+		if (std::string_view name = symbols->find(address); !name.empty())
+		{
+			out << name;
+			return;
+		}
+	}
+
+	char hex[6];
+	std::snprintf(hex, sizeof(hex), "$%04X", address);
+	out << hex;
+}
+
+
+Profiler::Profiler()
+{
+	reset();
+}
+
+
+void Profiler::reset()
+{
+	address_cycles.assign(0x10000, 0);
+	exclusive.assign(0x10000, 0);
+	inclusive.assign(0x10000, 0);
+	calls.assign(0x10000, 0);
+	active.assign(0x10000, 0);
+
+	stack.clear();
+	tree.clear();
+	children.clear();
+	total = 0;
+	mark = 0;
+}
+
+
+uint8_t Profiler::step(mos6502& cpu)
+{
+	ProfilerHooks hooks{ *this };
+	return cpu.step(hooks);
+}
+
+
+void Profiler::instruction(uint16_t pc, uint8_t opcode, uint8_t cycles, uint16_t next_pc)
+{
+	// The first instruction recorded is the root of the call tree
+	if (stack.empty())
+		enter(pc, 0);
+
+	total += cycles;
+	address_cycles[pc] += cycles;
+
+	if (opcode == JSR)
+		enter(next_pc, 0);
+
+	// The root frame is never left, unbalanced returns (e.g. RTS used as a jump) are ignored
+	else if ((opcode == RTS || opcode == RTI) && stack.size() > 1)
+		leave();
+}
+
+
+void Profiler::interrupt(uint16_t handler, uint8_t cycles)
+{
+	enter(handler, cycles);
+}
+
+
+void Profiler::flush()
+{
+	if (!stack.empty())
+	{
+		exclusive[stack.back().routine] += total - mark;
+		tree[stack.back().node].cycles += total - mark;
+	}
+
+	mark = total;
+}
+
+
+void Profiler::enter(uint16_t routine, uint8_t cycles)
+{
+	flush();
+
+	uint32_t node;
+
+	if (stack.empty())
+	{
+		node = static_cast<uint32_t>(tree.size());
+		tree.push_back({ node, routine });
+	}
+	else if (stack.size() >= max_tree_depth)
+		node = stack.back().node;
+	else
+	{
+		uint32_t parent = stack.back().node;
+		uint64_t key = (static_cast<uint64_t>(parent) << 16) | routine;
+
+		auto [it, inserted] = children.try_emplace(key, static_cast<uint32_t>(tree.size()));
+		if (inserted)
+			tree.push_back({ parent, routine });
+
+		node = it->second;
+	}
+
+	stack.push_back({ routine, node, total });
+	++calls[routine];
+	++active[routine];
+
+	total += cycles;
+}
+
+
+void Profiler::leave()
+{
+	flush();
+
+	Frame frame = stack.back();
+	stack.pop_back();
+
+	// Only the outermost frame of a recursive routine counts
+	if (--active[frame.routine] == 0)
+		inclusive[frame.routine] += total - frame.start;
+}
+
+
+const std::vector<uint64_t>& Profiler::addressCycles() const
+{
+	return address_cycles;
+}
+
+
+uint64_t Profiler::totalCycles() const
+{
+	return total;
+}
+
+
+std::vector<Profiler::Routine> Profiler::routines() const
+{
+	std::vector<Routine> result;
+
+	// Frames still active add the cycles spent so far
+	std::vector<uint64_t> open(0x10000, 0);
+	std::vector<bool> counted(0x10000, false);
+	for (const Frame& frame : stack)
+	{
+		if (!counted[frame.routine])
+		{
+			open[frame.routine] = total - frame.start;
+			counted[frame.routine] = true;
+		}
+	}
+
+	for (uint32_t address = 0; address < 0x10000; ++address)
+		if (calls[address] > 0)
+			result.push_back({ static_cast<uint16_t>(address), calls[address], inclusive[address] + open[address], exclusive[address] });
+
+	// The cycles not flushed yet belong to the current routine
+	if (!stack.empty())
+		for (Routine& routine : result)
+			if (routine.address == stack.back().routine)
+				routine.exclusive += total - mark;
+
+	std::sort(result.begin(), result.end(), [](const Routine& a, const Routine& b) { return a.exclusive > b.exclusive; });
+
+	return result;
+}
+
+
+void Profiler::writeFolded(std::ostream& out, const SymbolTable* symbols) const
+{
+	std::vector<uint16_t> path;
+
+	for (uint32_t node = 0; node < tree.size(); ++node)
+	{
+		// The cycles not flushed yet belong to the current node
+		uint64_t cycles = tree[node].cycles + (!stack.empty() && stack.back().node == node ? total - mark : 0);
+
+		if (cycles == 0)
+			continue;
+
+		path.clear();
+		for (uint32_t n = node; ; n = tree[n].parent)
+		{
+			path.push_back(tree[n].routine);
+			if (tree[n].parent == n)
+				break;
+		}
+
+		for (auto it = path.rbegin(); it != path.rend(); ++it)
+		{
+			if (it != path.rbegin())
+				out << ';';
+			writeName(out, *it, symbols);
+		}
+
+		out << ' ' << cycles << '\n';
+	}
+}
+
+
+void Profiler::writeReport(std::ostream& out, const SymbolTable* symbols, std::size_t top) const
+{
+	char line[64];
+
+	auto percent = [this](uint64_t cycles) {
+		return total ? 100.0 * static_cast<double>(cycles) / static_cast<double>(total) : 0.0;
+	};
+
+	out << "Total cycles: " << total << "\n\nHottest routines:\n";
+	out << "   exclusive       %     inclusive       %        calls  routine\n";
+
+	std::vector<Routine> sorted = routines();
+	for (std::size_t i = 0; i < std::min(top, sorted.size()); ++i)
+	{
+		const Routine& routine = sorted[i];
+
+		std::snprintf(line, sizeof(line), "%12llu  %5.1f%%  %12llu  %5.1f%%  %11llu  ",
+			static_cast<unsigned long long>(routine.exclusive), percent(routine.exclusive),
+			static_cast<unsigned long long>(routine.inclusive), percent(routine.inclusive),
+			static_cast<unsigned long long>(routine.calls));
+		out << line;
+		writeName(out, routine.address, symbols);
+		out << '\n';
+	}
+
+	out << "\nHottest addresses:\n";
+	out << "      cycles       %  address\n";
+
+	std::vector<uint16_t> addresses;
+	for (uint32_t address = 0; address < 0x10000; ++address)
+		if (address_cycles[address] > 0)
+			addresses.push_back(static_cast<uint16_t>(address));
+
+	std::size_t count = std::min(top, addresses.size());
+	std::partial_sort(addresses.begin(), addresses.begin() + count, addresses.end(),
+		[this](uint16_t a, uint16_t b) { return address_cycles[a] > address_cycles[b]; });
+
+	for (std::size_t i = 0; i < count; ++i)
+	{
+		std::snprintf(line, sizeof(line), "%12llu  %5.1f%%  ",
+			static_cast<unsigned long long>(address_cycles[addresses[i]]), percent(address_cycles[addresses[i]]));
+		out << line;
+		writeName(out, addresses[i], symbols);
+		out << '\n';
+	}
+}
@@ -0,0 +1,187 @@
+///
+/// Implementation of SymbolTable
+///
+
+#include <cstdint>
+#include <algorithm>
+#include <charconv>
+#include <fstream>
+#include <sstream>
+#include <stdexcept>
+
+#include "../symbols.h"
+
+
+void SymbolTable::add(uint16_t address, std::string_view name)
+{
+	auto it = std::lower_bound(symbols.begin(), symbols.end(), address,
+		[](const Symbol& symbol, uint16_t address) { return symbol.address < address; });
+
+	if (it != symbols.end() && it->address == address)
+		return;
+
+	Symbol symbol{ address, static_cast<uint16_t>(name.size()), static_cast<uint32_t>(names.size()) };
+	names.append(name);
+
+	symbols.insert(it, symbol);
+}
+
+
+std::string_view SymbolTable::find(uint16_t address) const
+{
+	auto it = std::lower_bound(symbols.begin(), symbols.end(), address,
+		[](const Symbol& symbol, uint16_t address) { return symbol.address < address; });
+
+	if (it == symbols.end() || it->address != address)
+		return { };
+
+	return std::string_view{ names }.substr(it->offset, it->length);
+}
+
+
+std::size_t SymbolTable::size() const
+{
+	return symbols.size();
+}
+
+
+void SymbolTable::clear()
+{
+	symbols.clear();
+	names.clear();
+}
+
+
+void SymbolTable::sort()
+{
+	// Stable, so that the first name added to an address is the one kept
+	std::stable_sort(symbols.begin(), symbols.end(),
+		[](const Symbol& a, const Symbol& b) { return a.address < b.address; });
+
+	symbols.erase(std::unique(symbols.begin(), symbols.end(),
+		[](const Symbol& a, const Symbol& b) { return a.address == b.address; }), symbols.end());
+}
+
+
+void SymbolTable::loadViceLabels(const std::string& path)
+{
+	std::ifstream file{ path, std::ios::binary };
+	if (!file)
+		throw std::runtime_error("Can't open label file " + path);
+
+	std::stringstream contents;
+	contents << file.rdbuf();
+
+	parseViceLabels(contents.view());
+}
+
+
+std::size_t SymbolTable::parseViceLabels(std::string_view text)
+{
+	std::size_t count = 0;
+	std::size_t line_number = 0;
+
+	while (!text.empty())
+	{
+		std::size_t end = text.find('\n');
+		std::string_view line = text.substr(0, end);
+		text.remove_prefix(end == std::string_view::npos ? text.size() : end + 1);
+		++line_number;
+
+		if (!line.empty() && line.back() == '\r')
+			line.remove_suffix(1);
+
+		// Splits the line in whitespace separated fields
+		std::string_view fields[3];
+		std::size_t field_count = 0;
+		for (std::size_t pos = 0; field_count < 3; )
+		{
+			pos = line.find_first_not_of(" \t", pos);
+			if (pos == std::string_view::npos)
+				break;
+
+			std::size_t field_end = line.find_first_of(" \t", pos);
+			fields[field_count++] = line.substr(pos, field_end - pos);
+			pos = field_end;
+		}
+
+		// Empty lines and other monitor commands are ignored
+		if (field_count == 0 || fields[0] != "al")
+			continue;
+
+		if (field_count < 3)
+			throw std::runtime_error("Malformed label at line " + std::to_string(line_number));
+
+		// The address can have a memory space prefix ("C:")
+		std::string_view address_text = fields[1];
+		if (std::size_t colon = address_text.find(':'); colon != std::string_view::npos)
+			address_text.remove_prefix(colon + 1);
+
+		unsigned address = 0;
+		auto [ptr, error] = std::from_chars(address_text.data(), address_text.data() + address_text.size(), address, 16);
+		if (error != std::errc{ } || ptr != address_text.data() + address_text.size() || address > 0xFFFF)
+			throw std::runtime_error("Malformed address at line " + std::to_string(line_number));
+
+		// ld65 prefixes every name with a dot
+		std::string_view name = fields[2];
+		if (name.front() == '.')
+			name.remove_prefix(1);
+
+		symbols.push_back({ static_cast<uint16_t>(address), static_cast<uint16_t>(name.size()), static_cast<uint32_t>(names.size()) });
+		names.append(name);
+		++count;
+	}
+
+	sort();
+
+	return count;
+}
+
+
+std::size_t SymbolTable::generateLabels(std::span<const mos6502::Disassembly> records)
+{
+	static constexpr char hex_digits[] = "0123456789ABCDEF";
+
+	std::vector<uint16_t> targets;
+
+	for (const auto& record : records)
+	{
+		if (record.mode == mos6502::AddressMode::REL)
+			targets.push_back(static_cast<uint16_t>(record.address + record.length + static_cast<int8_t>(record.operands[0])));
+
+		// BBR, BBS
+		else if (record.mode == mos6502::AddressMode::ZPR)
+			targets.push_back(static_cast<uint16_t>(record.address + record.length + static_cast<int8_t>(record.operands[1])));
+
+		// JMP absolute, JSR
+		else if (record.opcode == 0x4C || record.opcode == 0x20)
+			targets.push_back((static_cast<uint16_t>(record.operands[1]) << 8) | record.operands[0]);
+	}
+
+	// A name is appended to the pool only for a new address, before the appends unsort the symbols
+	std::sort(targets.begin(), targets.end());
+	targets.erase(std::unique(targets.begin(), targets.end()), targets.end());
+	std::erase_if(targets, [this](uint16_t target) { return !find(target).empty(); });
+
+	// A label is defined only where the listing has an instruction: a target outside the records or in the
+	// middle of an instruction stays an address
+	std::erase_if(targets, [records](uint16_t target) {
+		return !std::ranges::binary_search(records, target, { }, &mos6502::Disassembly::address);
+	});
+
+	std::size_t before = symbols.size();
+
+	for (uint16_t target : targets)
+	{
+		char name[] = "L_0000";
+		for (int i = 0; i < 4; ++i)
+			name[2 + i] = hex_digits[(target >> ((3 - i) * 4)) & 0x0F];
+
+		symbols.push_back({ target, 6, static_cast<uint32_t>(names.size()) });
+		names.append(name, 6);
+	}
+
+	sort();
+
+	return symbols.size() - before;
+}
@@ -0,0 +1,359 @@
+///
+/// Implementation of CycleAnalyzer
+///
+
+#include <cstdint>
+#include <algorithm>
+#include <limits>
+
+#include "../timing.h"
+#include "../analyzer.h"
+
+
+// Target of an edge that leaves the routine
+static constexpr int32_t exit_node = -1;
+
+
+// A transition from an instruction to the next one, with the cycles spent by the first
+struct Edge {
+	int32_t  to;
+	uint64_t best;
+	uint64_t worst;
+};
+
+
+// An instruction of the routine
+struct Node {
+	std::vector<Edge> edges;
+	// Cycles of the repeated iterations of the loop headed by this instruction
+	uint64_t extra_best	 = 0;
+	uint64_t extra_worst = 0;
+};
+
+
+CycleAnalyzer::CycleAnalyzer(std::span<const uint8_t, 0x10000> memory)
+	: memory{ memory }
+{ }
+
+
+void CycleAnalyzer::setLoopBound(uint16_t header, uint32_t min, uint32_t max)
+{
+	bounds[header] = { std::max(min, 1u), std::max({ min, max, 1u }) };
+	routines.clear();
+}
+
+
+CycleAnalyzer::Timing CycleAnalyzer::analyze(uint16_t entry)
+{
+	if (auto it = routines.find(entry); it != routines.end())
+		return it->second;
+
+	Timing timing;
+	call_stack.push_back(entry);
+
+	// Builds the control flow graph, one node per instruction
+	std::vector<Node> nodes;
+	std::vector<uint16_t> addresses;
+	std::vector<int32_t> index(0x10000, -1);
+
+	// Returns the node of the instruction at address, creating it if needed
+	auto nodeOf = [&](uint16_t address) {
+		if (index[address] < 0)
+		{
+			index[address] = static_cast<int32_t>(nodes.size());
+			nodes.emplace_back();
+			addresses.push_back(address);
+		}
+		return index[address];
+	};
+
+	nodeOf(entry);
+
+	for (std::size_t n = 0; n < nodes.size(); ++n)
+	{
+		auto record = mos6502::decode(memory, addresses[n]);
+		uint16_t next = static_cast<uint16_t>(record.address + record.length);
+
+		uint64_t best  = record.cycles;
+		uint64_t worst = record.cycles + (mos6502::pagePenalty(record.opcode) ? 1 : 0);
+
+		// nodes can be reallocated by nodeOf(), edges are added after it
+		switch (CodeAnalyzer::flowOf(record))
+		{
+		case CodeAnalyzer::Flow::Next:
+		{
+			int32_t to = nodeOf(next);
+			nodes[n].edges.push_back({ to, best, worst });
+			break;
+		}
+
+		case CodeAnalyzer::Flow::Branch:
+		{
+			// Taken: one more cycle, another one if the target is in a different page
+			uint16_t target = CodeAnalyzer::branchTarget(record);
+			uint64_t taken = best + 1 + (((target & 0xFF00) != (next & 0xFF00)) ? 1 : 0);
+
+			int32_t to_target = nodeOf(target);
+			int32_t to_next = nodeOf(next);
+			nodes[n].edges.push_back({ to_target, taken, taken });
+			nodes[n].edges.push_back({ to_next, best, best });
+			break;
+		}
+
+		case CodeAnalyzer::Flow::Jump:
+		{
+			uint16_t target = CodeAnalyzer::jumpTarget(record);
+
+			// BRA is always taken
+			if (record.mode == mos6502::AddressMode::REL)
+				best = worst = best + 1 + (((target & 0xFF00) != (next & 0xFF00)) ? 1 : 0);
+
+			int32_t to = nodeOf(target);
+			nodes[n].edges.push_back({ to, best, worst });
+			break;
+		}
+
+		case CodeAnalyzer::Flow::Call:
+		{
+			uint16_t callee = CodeAnalyzer::operandWord(record);
+
+			if (std::find(call_stack.begin(), call_stack.end(), callee) != call_stack.end())
+			{
+				timing.bounded = false;
+				timing.unresolved.push_back(record.address);
+			}
+			else
+			{
+				Timing called = analyze(callee);
+
+				best  += called.best;
+				worst += called.worst;
+
+				if (!called.bounded)
+				{
+					timing.bounded = false;
+					timing.unbounded_loops.insert(timing.unbounded_loops.end(), called.unbounded_loops.begin(), called.unbounded_loops.end());
+					timing.unresolved.insert(timing.unresolved.end(), called.unresolved.begin(), called.unresolved.end());
+				}
+			}
+
+			int32_t to = nodeOf(next);
+			nodes[n].edges.push_back({ to, best, worst });
+			break;
+		}
+
+		case CodeAnalyzer::Flow::JumpIndirect:
+			timing.bounded = false;
+			timing.unresolved.push_back(record.address);
+			nodes[n].edges.push_back({ exit_node, best, worst });
+			break;
+
+		case CodeAnalyzer::Flow::Stop:
+			// RTS and RTI return to the caller, BRK and KIL don't
+			if (record.opcode != 0x60 && record.opcode != 0x40)
+			{
+				timing.bounded = false;
+				timing.unresolved.push_back(record.address);
+			}
+			nodes[n].edges.push_back({ exit_node, best, worst });
+			break;
+		}
+	}
+
+	// Removing the back edges leaves a DAG, their targets are the loop headers
+	std::vector<std::pair<int32_t, Edge>> back_edges;
+	std::vector<int32_t> order;
+	{
+		enum Color : uint8_t { White, Gray, Black };
+		std::vector<Color> color(nodes.size(), White);
+		std::vector<std::pair<int32_t, std::size_t>> stack{ { 0, 0 } };
+		color[0] = Gray;
+
+		while (!stack.empty())
+		{
+			auto& [node, edge] = stack.back();
+
+			if (edge == nodes[node].edges.size())
+			{
+				color[node] = Black;
+				order.push_back(node);
+				stack.pop_back();
+				continue;
+			}
+
+			Edge current = nodes[node].edges[edge];
+
+			if (current.to != exit_node && color[current.to] == Gray)
+			{
+				back_edges.push_back({ node, current });
+				nodes[node].edges.erase(nodes[node].edges.begin() + edge);
+				continue;
+			}
+
+			++edge;
+
+			if (current.to != exit_node && color[current.to] == White)
+			{
+				color[current.to] = Gray;
+				stack.push_back({ current.to, 0 });
+			}
+		}
+
+		std::reverse(order.begin(), order.end());
+	}
+
+	// Adds the repeated iterations of every loop to its header
+	std::vector<std::vector<int32_t>> predecessors(nodes.size());
+	for (int32_t n = 0; n < static_cast<int32_t>(nodes.size()); ++n)
+		for (const Edge& edge : nodes[n].edges)
+			if (edge.to != exit_node)
+				predecessors[edge.to].push_back(n);
+
+	// Loops are collected by header, the body is every node that reaches a back edge without passing the header
+	struct Loop {
+		int32_t header;
+		std::vector<bool> body;
+		std::size_t size = 0;
+		std::vector<std::pair<int32_t, Edge>> latches;
+	};
+
+	std::vector<Loop> loops;
+	for (const auto& back_edge : back_edges)
+	{
+		int32_t header = back_edge.second.to;
+
+		auto loop = std::find_if(loops.begin(), loops.end(), [header](const Loop& loop) { return loop.header == header; });
+		if (loop == loops.end())
+		{
+			loops.push_back({ header, std::vector<bool>(nodes.size(), false), 0, { } });
+			loop = loops.end() - 1;
+			loop->body[header] = true;
+			loop->size = 1;
+		}
+
+		loop->latches.push_back(back_edge);
+
+		std::vector<int32_t> stack{ back_edge.first };
+		while (!stack.empty())
+		{
+			int32_t node = stack.back();
+			stack.pop_back();
+
+			if (loop->body[node])
+				continue;
+
+			loop->body[node] = true;
+			++loop->size;
+
+			for (int32_t predecessor : predecessors[node])
+				stack.push_back(predecessor);
+		}
+	}
+
+	// Inner loops first, so that their iterations are part of the outer loops bodies
+	std::sort(loops.begin(), loops.end(), [](const Loop& a, const Loop& b) { return a.size < b.size; });
+
+	constexpr uint64_t unreached = std::numeric_limits<uint64_t>::max();
+
+	std::vector<uint64_t> best(nodes.size());
+	std::vector<uint64_t> worst(nodes.size());
+
+	for (const Loop& loop : loops)
+	{
+		std::fill(best.begin(), best.end(), unreached);
+		std::fill(worst.begin(), worst.end(), 0);
+		std::vector<bool> reached(nodes.size(), false);
+
+		best[loop.header] = 0;
+		worst[loop.header] = 0;
+		reached[loop.header] = true;
+
+		// Longest and shortest paths from the header, inside the body
+		for (int32_t node : order)
+		{
+			if (!loop.body[node] || !reached[node])
+				continue;
+
+			for (const Edge& edge : nodes[node].edges)
+			{
+				if (edge.to == exit_node || !loop.body[edge.to])
+					continue;
+
+				reached[edge.to] = true;
+				best[edge.to]  = std::min(best[edge.to], best[node] + edge.best + nodes[edge.to].extra_best);
+				worst[edge.to] = std::max(worst[edge.to], worst[node] + edge.worst + nodes[edge.to].extra_worst);
+			}
+		}
+
+		uint64_t iteration_best = unreached;
+		uint64_t iteration_worst = 0;
+		for (const auto& [latch, edge] : loop.latches)
+		{
+			if (!reached[latch])
+				continue;
+
+			iteration_best	= std::min(iteration_best, best[latch] + edge.best);
+			iteration_worst = std::max(iteration_worst, worst[latch] + edge.worst);
+		}
+		if (iteration_best == unreached)
+			iteration_best = 0;
+
+		LoopBound bound{ 1, 1 };
+		if (auto it = bounds.find(addresses[loop.header]); it != bounds.end())
+			bound = it->second;
+		else
+		{
+			timing.bounded = false;
+			timing.unbounded_loops.push_back(addresses[loop.header]);
+		}
+
+		// The last iteration is counted by the paths that leave the loop
+		nodes[loop.header].extra_best  += (bound.min - 1) * iteration_best;
+		nodes[loop.header].extra_worst += (bound.max - 1) * iteration_worst;
+	}
+
+	// Shortest and longest paths from the entry to the exits
+	std::fill(best.begin(), best.end(), unreached);
+	std::fill(worst.begin(), worst.end(), 0);
+	best[0]	 = nodes[0].extra_best;
+	worst[0] = nodes[0].extra_worst;
+
+	uint64_t routine_best = unreached;
+	uint64_t routine_worst = 0;
+
+	for (int32_t node : order)
+	{
+		for (const Edge& edge : nodes[node].edges)
+		{
+			if (edge.to == exit_node)
+			{
+				routine_best  = std::min(routine_best, best[node] + edge.best);
+				routine_worst = std::max(routine_worst, worst[node] + edge.worst);
+				continue;
+			}
+
+			best[edge.to]  = std::min(best[edge.to], best[node] + edge.best + nodes[edge.to].extra_best);
+			worst[edge.to] = std::max(worst[edge.to], worst[node] + edge.worst + nodes[edge.to].extra_worst);
+		}
+	}
+
+	// No way out (e.g. JMP to itself): the routine never ends
+	if (routine_best == unreached)
+	{
+		timing.bounded = false;
+		routine_best = 0;
+	}
+
+	timing.best	 = routine_best;
+	timing.worst = routine_worst;
+
+	std::sort(timing.unbounded_loops.begin(), timing.unbounded_loops.end());
+	timing.unbounded_loops.erase(std::unique(timing.unbounded_loops.begin(), timing.unbounded_loops.end()), timing.unbounded_loops.end());
+	std::sort(timing.unresolved.begin(), timing.unresolved.end());
+	timing.unresolved.erase(std::unique(timing.unresolved.begin(), timing.unresolved.end()), timing.unresolved.end());
+
+	call_stack.pop_back();
+	routines[entry] = timing;
+
+	return timing;
+}
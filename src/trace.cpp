@@ -0,0 +1,615 @@
+///
+/// Implementation of TraceWriter, TraceReader and the nestest log converter
+///
+
+#include <cstdint>
+#include <cerrno>
+#include <cstring>
+#include <bit>
+#include <chrono>
+#include <stdexcept>
+#include <system_error>
+#include <utility>
+
+#include "../trace.h"
+
+
+// File header, the last byte is the version
+static constexpr char header[8] = { '6', '5', '0', '2', 'T', 'R', 'C', 1 };
+
+// Blocks are written when they reach this size
+static constexpr std::size_t block_size = 64 * 1024;
+
+
+// Bits of the first byte of an encoded record, telling which fields follow it.
+// A field that is not present is predicted from the previous record
+enum RecordFields : uint8_t {
+	HasPC	  = 1 << 0,	// Else PC follows the previous instruction
+	HasBytes  = 1 << 1,	// Else opcode and operands are the ones last seen at PC in this block
+	HasA	  = 1 << 2,	// Else the registers are unchanged
+	HasX	  = 1 << 3,
+	HasY	  = 1 << 4,
+	HasP	  = 1 << 5,
+	HasSP	  = 1 << 6,
+	HasCycles = 1 << 7	// Else the previous instruction took its base number of cycles
+};
+
+
+// Instructions last seen at every address, valid only for the block with the same stamp
+class TraceCodeCache
+{
+public:
+
+	TraceCodeCache()
+		: code(0x10000), stamps(0x10000, 0)
+	{ }
+
+	// Forgets everything, called at every block
+	void clear() { ++stamp; }
+
+	bool find(uint16_t pc, TraceRecord& record) const
+	{
+		if (stamps[pc] != stamp)
+			return false;
+
+		record.opcode	   = code[pc] & 0xFF;
+		record.operands[0] = (code[pc] >> 8) & 0xFF;
+		record.operands[1] = (code[pc] >> 16) & 0xFF;
+		return true;
+	}
+
+	void store(const TraceRecord& record)
+	{
+		code[record.pc] = record.opcode | (record.operands[0] << 8) | (record.operands[1] << 16);
+		stamps[record.pc] = stamp;
+	}
+
+private:
+	std::vector<uint32_t> code;
+	std::vector<uint32_t> stamps;
+	uint32_t stamp = 1;
+};
+
+
+/*												*/
+/*			  Block compression (LZ77)			*/
+/*												*/
+
+// A sequence is: token (literals length << 4 | match length - 4), extra literals length bytes,
+// literals, match offset (u16), extra match length bytes. Lengths of 15 continue in the next
+// bytes, added up until one is less than 255. The last sequence has literals only
+
+static constexpr std::size_t min_match = 4;
+
+
+static void writeLength(std::vector<uint8_t>& out, std::size_t length)
+{
+	for (; length >= 255; length -= 255)
+		out.push_back(255);
+	out.push_back(static_cast<uint8_t>(length));
+}
+
+
+static void compress(const std::vector<uint8_t>& in, std::vector<uint8_t>& out)
+{
+	out.clear();
+
+	std::vector<uint32_t> table(4096, UINT32_MAX);
+	auto hash = [&](std::size_t pos) {
+		uint32_t value;
+		std::memcpy(&value, in.data() + pos, 4);
+		return (value * 2654435761u) >> 20;
+	};
+
+	std::size_t literals = 0;
+	std::size_t pos = 0;
+
+	auto emit = [&](std::size_t match_length, std::size_t offset) {
+		uint8_t token = static_cast<uint8_t>(std::min<std::size_t>(literals, 15) << 4);
+		if (match_length)
+			token |= static_cast<uint8_t>(std::min<std::size_t>(match_length - min_match, 15));
+		out.push_back(token);
+
+		if (literals >= 15)
+			writeLength(out, literals - 15);
+		out.insert(out.end(), in.begin() + (pos - literals), in.begin() + pos);
+
+		if (match_length)
+		{
+			out.push_back(offset & 0xFF);
+			out.push_back(offset >> 8);
+			if (match_length - min_match >= 15)
+				writeLength(out, match_length - min_match - 15);
+		}
+
+		literals = 0;
+	};
+
+	while (pos + min_match <= in.size())
+	{
+		uint32_t h = hash(pos);
+		std::size_t candidate = table[h];
+		table[h] = static_cast<uint32_t>(pos);
+
+		if (candidate != UINT32_MAX && pos - candidate <= 0xFFFF && std::memcmp(in.data() + candidate, in.data() + pos, min_match) == 0)
+		{
+			std::size_t length = min_match;
+			while (pos + length < in.size() && in[candidate + length] == in[pos + length])
+				++length;
+
+			emit(length, pos - candidate);
+			pos += length;
+		}
+		else
+		{
+			++pos;
+			++literals;
+		}
+	}
+
+	literals += in.size() - pos;
+	pos = in.size();
+	emit(0, 0);
+}
+
+
+static void decompress(const uint8_t* in, std::size_t size, std::vector<uint8_t>& out, std::size_t raw_size)
+{
+	out.clear();
+	out.reserve(raw_size);
+
+	const uint8_t* end = in + size;
+
+	auto corrupted = [] { throw std::runtime_error("Corrupted trace block"); };
+
+	auto readLength = [&](std::size_t length) {
+		if (length == 15)
+		{
+			uint8_t byte;
+			do {
+				if (in == end)
+					corrupted();
+				byte = *in++;
+				length += byte;
+			} while (byte == 255);
+		}
+		return length;
+	};
+
+	while (in < end)
+	{
+		uint8_t token = *in++;
+
+		std::size_t literals = readLength(token >> 4);
+		if (static_cast<std::size_t>(end - in) < literals)
+			corrupted();
+		out.insert(out.end(), in, in + literals);
+		in += literals;
+
+		// The last sequence has no match
+		if (in == end)
+			break;
+
+		if (end - in < 2)
+			corrupted();
+		std::size_t offset = in[0] | (in[1] << 8);
+		in += 2;
+
+		std::size_t length = readLength(token & 0x0F) + min_match;
+		if (offset == 0 || offset > out.size() || out.size() + length > raw_size)
+			corrupted();
+
+		// Byte by byte, the match can overlap the bytes it produces
+		std::size_t from = out.size() - offset;
+		for (std::size_t i = 0; i < length; ++i)
+			out.push_back(out[from + i]);
+	}
+
+	if (out.size() != raw_size)
+		corrupted();
+}
+
+
+// Writes a little endian u32, returns false on failure
+static bool writeU32(std::FILE* file, uint32_t value)
+{
+	uint8_t bytes[4] = { static_cast<uint8_t>(value), static_cast<uint8_t>(value >> 8), static_cast<uint8_t>(value >> 16), static_cast<uint8_t>(value >> 24) };
+	return std::fwrite(bytes, 1, 4, file) == 4;
+}
+
+
+/*												*/
+/*				   TraceWriter					*/
+/*												*/
+
+TraceWriter::TraceWriter(const std::string& path, std::size_t ring_capacity)
+	: ring(std::bit_ceil(std::max<std::size_t>(ring_capacity, 2))), mask{ ring.size() - 1 },
+	  path{ path }, cache{ std::make_unique<TraceCodeCache>() }
+{
+	file = std::fopen(path.c_str(), "wb");
+	if (!file)
+		throw std::system_error(errno, std::generic_category(), path);
+
+	if (std::fwrite(header, 1, sizeof(header), file) != sizeof(header))
+	{
+		int error = errno;
+		std::fclose(file);
+		throw std::system_error(error, std::generic_category(), path);
+	}
+
+	block.reserve(block_size + 64);
+	writer = std::thread{ &TraceWriter::writerLoop, this };
+}
+
+
+TraceWriter::~TraceWriter()
+{
+	try
+	{
+		close();
+	}
+	catch (const std::system_error& error)
+	{
+		// Nobody called close() to get the error, it can't be thrown from here
+		std::fprintf(stderr, "Trace not written: %s\n", error.what());
+	}
+}
+
+
+void TraceWriter::record(const mos6502& cpu)
+{
+	mos6502::Disassembly instruction = cpu.decode(cpu.PC);
+
+	push({ cpu.clock_count, cpu.PC, instruction.opcode, { instruction.operands[0], instruction.operands[1] },
+		   cpu.A, cpu.X, cpu.Y, cpu.P, cpu.SP });
+}
+
+
+uint8_t TraceWriter::step(mos6502& cpu)
+{
+	TraceHooks hooks{ *this };
+	return cpu.step(hooks);
+}
+
+
+void TraceWriter::push(const TraceRecord& record)
+{
+	if (closing.load(std::memory_order_relaxed))
+		return;
+
+	std::size_t h = head.load(std::memory_order_relaxed);
+
+	if (h - tail.load(std::memory_order_acquire) == ring.size())
+	{
+		++waits;
+		while (h - tail.load(std::memory_order_acquire) == ring.size())
+			std::this_thread::yield();
+	}
+
+	ring[h & mask] = record;
+	head.store(h + 1, std::memory_order_release);
+	++pushed;
+}
+
+
+void TraceWriter::close()
+{
+	if (!writer.joinable())
+		return;
+
+	closing.store(true, std::memory_order_release);
+	writer.join();
+
+	if (write_error != 0)
+		throw std::system_error(std::exchange(write_error, 0), std::generic_category(), path);
+}
+
+
+uint64_t TraceWriter::records() const
+{
+	return pushed;
+}
+
+
+uint64_t TraceWriter::stalls() const
+{
+	return waits;
+}
+
+
+void TraceWriter::writerLoop()
+{
+	TraceCodeCache& cache = *this->cache;
+
+	for (;;)
+	{
+		// Read before head: once closing is seen, head has its final value
+		bool done = closing.load(std::memory_order_acquire);
+
+		std::size_t t = tail.load(std::memory_order_relaxed);
+		std::size_t h = head.load(std::memory_order_acquire);
+
+		if (t == h)
+		{
+			if (done)
+				break;
+
+			std::this_thread::sleep_for(std::chrono::microseconds(100));
+			continue;
+		}
+
+		for (; t != h; ++t)
+		{
+			const TraceRecord& record = ring[t & mask];
+
+			uint8_t fields = 0;
+			uint8_t encoded[16];
+			std::size_t size = 1;
+
+			if (record.pc != static_cast<uint16_t>(previous.pc + mos6502::length(previous.opcode)))
+			{
+				fields |= HasPC;
+				encoded[size++] = record.pc & 0xFF;
+				encoded[size++] = record.pc >> 8;
+			}
+
+			TraceRecord cached;
+			if (!cache.find(record.pc, cached) || cached.opcode != record.opcode ||
+				std::memcmp(cached.operands, record.operands, mos6502::length(record.opcode) - 1) != 0)
+			{
+				fields |= HasBytes;
+				encoded[size++] = record.opcode;
+				for (uint8_t i = 1; i < mos6502::length(record.opcode); ++i)
+					encoded[size++] = record.operands[i - 1];
+
+				cache.store(record);
+			}
+
+			if (record.A  != previous.A)  { fields |= HasA;  encoded[size++] = record.A;  }
+			if (record.X  != previous.X)  { fields |= HasX;  encoded[size++] = record.X;  }
+			if (record.Y  != previous.Y)  { fields |= HasY;  encoded[size++] = record.Y;  }
+			if (record.P  != previous.P)  { fields |= HasP;  encoded[size++] = record.P;  }
+			if (record.SP != previous.SP) { fields |= HasSP; encoded[size++] = record.SP; }
+
+			encoded[0] = fields;
+			block.insert(block.end(), encoded, encoded + size);
+
+			// Varint of the cycles elapsed, when they're not the predicted ones
+			uint64_t delta = record.cycle - previous.cycle;
+			if (delta != mos6502::baseCycles(previous.opcode) || block_records == 0)
+			{
+				block[block.size() - size] |= HasCycles;
+				for (; delta >= 0x80; delta >>= 7)
+					block.push_back(static_cast<uint8_t>(delta | 0x80));
+				block.push_back(static_cast<uint8_t>(delta));
+			}
+
+			previous = record;
+			++block_records;
+
+			if (block.size() >= block_size)
+				flushBlock();
+		}
+
+		tail.store(t, std::memory_order_release);
+	}
+
+	flushBlock();
+	if (std::fclose(file) != 0 && write_error == 0)
+		write_error = errno ? errno : EIO;
+	file = nullptr;
+}
+
+
+void TraceWriter::flushBlock()
+{
+	if (block_records == 0)
+		return;
+
+	// After a failed write the records are still consumed, so that push() doesn't wait forever
+	if (write_error == 0)
+	{
+		compress(block, compressed);
+
+		bool written = writeU32(file, static_cast<uint32_t>(block.size())) &&
+					   writeU32(file, static_cast<uint32_t>(compressed.size())) &&
+					   writeU32(file, block_records) &&
+					   std::fwrite(compressed.data(), 1, compressed.size(), file) == compressed.size();
+		if (!written)
+			write_error = errno ? errno : EIO;
+	}
+
+	// The next block starts from scratch
+	block.clear();
+	block_records = 0;
+	previous = TraceRecord{ };
+	cache->clear();
+}
+
+
+/*												*/
+/*				   TraceReader					*/
+/*												*/
+
+TraceReader::TraceReader(const std::string& path)
+	: cache{ std::make_unique<TraceCodeCache>() }
+{
+	file = std::fopen(path.c_str(), "rb");
+	if (!file)
+		throw std::system_error(errno, std::generic_category(), path);
+
+	char magic[sizeof(header)];
+	if (std::fread(magic, 1, sizeof(magic), file) != sizeof(magic) || std::memcmp(magic, header, sizeof(header)) != 0)
+	{
+		std::fclose(file);
+		throw std::runtime_error(path + " is not a trace file");
+	}
+}
+
+
+TraceReader::~TraceReader()
+{
+	if (file)
+		std::fclose(file);
+}
+
+
+// Reads a little endian u32, returns false at the end of the file
+static bool readU32(std::FILE* file, uint32_t& value)
+{
+	uint8_t bytes[4];
+	if (std::fread(bytes, 1, 4, file) != 4)
+		return false;
+
+	value = bytes[0] | (bytes[1] << 8) | (bytes[2] << 16) | (static_cast<uint32_t>(bytes[3]) << 24);
+	return true;
+}
+
+
+bool TraceReader::readBlock()
+{
+	uint32_t raw_size, compressed_size, records;
+
+	if (!readU32(file, raw_size))
+		return false;
+
+	if (!readU32(file, compressed_size) || !readU32(file, records))
+		throw std::runtime_error("Truncated trace block");
+
+	compressed.resize(compressed_size);
+	if (std::fread(compressed.data(), 1, compressed_size, file) != compressed_size)
+		throw std::runtime_error("Truncated trace block");
+
+	decompress(compressed.data(), compressed.size(), block, raw_size);
+
+	// Every block has its own code cache, like the writer's
+	position = 0;
+	remaining = records;
+	previous = TraceRecord{ };
+	cache->clear();
+
+	return true;
+}
+
+
+bool TraceReader::next(TraceRecord& record)
+{
+	while (remaining == 0)
+		if (!readBlock())
+			return false;
+
+	auto byte = [this] {
+		if (position >= block.size())
+			throw std::runtime_error("Corrupted trace record");
+		return block[position++];
+	};
+
+	uint8_t fields = byte();
+
+	record = previous;
+	record.operands[0] = record.operands[1] = 0;
+
+	record.pc = static_cast<uint16_t>(previous.pc + mos6502::length(previous.opcode));
+	if (fields & HasPC)
+	{
+		record.pc = byte();
+		record.pc |= byte() << 8;
+	}
+
+	if (fields & HasBytes)
+	{
+		record.opcode = byte();
+		for (uint8_t i = 1; i < mos6502::length(record.opcode); ++i)
+			record.operands[i - 1] = byte();
+
+		cache->store(record);
+	}
+	else if (!cache->find(record.pc, record))
+		throw std::runtime_error("Corrupted trace record");
+
+	if (fields & HasA)	record.A  = byte();
+	if (fields & HasX)	record.X  = byte();
+	if (fields & HasY)	record.Y  = byte();
+	if (fields & HasP)	record.P  = byte();
+	if (fields & HasSP) record.SP = byte();
+
+	uint64_t delta = mos6502::baseCycles(previous.opcode);
+	if (fields & HasCycles)
+	{
+		delta = 0;
+		for (int shift = 0; ; shift += 7)
+		{
+			uint8_t b = byte();
+			delta |= static_cast<uint64_t>(b & 0x7F) << shift;
+			if (!(b & 0x80))
+				break;
+		}
+	}
+	record.cycle = previous.cycle + delta;
+
+	previous = record;
+	--remaining;
+
+	return true;
+}
+
+
+uint64_t writeNestestLog(TraceReader& reader, std::ostream& out)
+{
+	static constexpr char hex_digits[] = "0123456789ABCDEF";
+
+	TraceRecord record;
+	uint64_t count = 0;
+
+	std::string line;
+
+	auto hex = [&](unsigned value, int digits) {
+		for (int shift = (digits - 1) * 4; shift >= 0; shift -= 4)
+			line.push_back(hex_digits[(value >> shift) & 0x0F]);
+	};
+
+	while (reader.next(record))
+	{
+		mos6502::Disassembly instruction{ };
+		instruction.address		= record.pc;
+		instruction.opcode		= record.opcode;
+		instruction.mode		= mos6502::addressMode(record.opcode);
+		instruction.operands[0] = record.operands[0];
+		instruction.operands[1] = record.operands[1];
+		instruction.length		= mos6502::length(record.opcode);
+
+		char text[mos6502::max_format_length];
+		std::size_t length = mos6502::format(instruction, text);
+
+		line.clear();
+		hex(record.pc, 4);
+		line += "  ";
+		hex(record.opcode, 2);
+		for (uint8_t i = 0; i < 2; ++i)
+		{
+			line.push_back(' ');
+			if (i + 1 < instruction.length)
+				hex(record.operands[i], 2);
+			else
+				line += "  ";
+		}
+		// nestest marks the illegal opcodes with a '*' just before the mnemonic
+		line += mos6502::undocumented(record.opcode) ? " *" : "  ";
+		line.append(text, length);
+		line.resize(48, ' ');
+
+		line += "A:";  hex(record.A, 2);
+		line += " X:"; hex(record.X, 2);
+		line += " Y:"; hex(record.Y, 2);
+		line += " P:"; hex(record.P, 2);
+		line += " SP:"; hex(record.SP, 2);
+		line += " CYC:";
+		line += std::to_string(record.cycle);
+		line.push_back('\n');
+
+		out << line;
+		++count;
+	}
+
+	return count;
+}
@@ -0,0 +1,51 @@
+///
+/// Implementation of TrapTable
+///
+
+#include <cstdint>
+#include <stdexcept>
+#include <utility>
+
+#include "../traps.h"
+
+
+void TrapTable::set(uint16_t address, Handler handler)
+{
+	if (!handler)
+		throw std::invalid_argument("Empty trap handler");
+
+	handlers[address] = std::move(handler);
+	bits[address >> 6] |= uint64_t{ 1 } << (address & 63);
+}
+
+
+void TrapTable::set(uint16_t address, uint32_t cycles, std::function<void(mos6502& cpu)> handler)
+{
+	if (!handler)
+		throw std::invalid_argument("Empty trap handler");
+
+	set(address, [cycles, handler = std::move(handler)](mos6502& cpu) {
+		handler(cpu);
+		return cycles;
+	});
+}
+
+
+void TrapTable::clear(uint16_t address)
+{
+	handlers.erase(address);
+	bits[address >> 6] &= ~(uint64_t{ 1 } << (address & 63));
+}
+
+
+void TrapTable::clear()
+{
+	handlers.clear();
+	bits.fill(0);
+}
+
+
+uint32_t TrapTable::call(uint16_t address, mos6502& cpu) const
+{
+	return handlers.at(address)(cpu);
+}
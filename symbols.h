@@ -0,0 +1,62 @@
+#pragma once
+
+///
+/// Symbol table used to print labels in the disassembly
+///
+
+#include <cstdint>
+#include <span>
+#include <string>
+#include <string_view>
+#include <vector>
+
+#include "mos6502.h"
+
+
+// Maps addresses to names, stored in a flat sorted vector with all names in a single pool
+class SymbolTable
+{
+public:
+
+	// Adds a symbol, an address that already has one keeps the old name
+	void add(uint16_t address, std::string_view name);
+
+	// Returns the name of the symbol at address, or an empty string
+	std::string_view find(uint16_t address) const;
+
+	// Number of symbols
+	std::size_t size() const;
+
+	// Removes every symbol
+	void clear();
+
+	// Loads a VICE label file, as produced by "ld65 -Ln" or VICE's monitor
+	// (lines like "al C:C123 .init_video"). Throws std::runtime_error on failure
+	void loadViceLabels(const std::string& path);
+
+	// Parses the contents of a VICE label file, returns the number of symbols found
+	// Throws std::runtime_error on a malformed line
+	std::size_t parseViceLabels(std::string_view text);
+
+	// Adds a label named L_XXXX for every branch, JMP and JSR target of records that has no symbol and is the
+	// address of one of the records, which must be in address order like disassemble() returns them.
+	// Returns the number of labels added
+	std::size_t generateLabels(std::span<const mos6502::Disassembly> records);
+
+private:
+
+	// A symbol, its name is stored in names
+	struct Symbol {
+		uint16_t address;
+		uint16_t length;
+		uint32_t offset;
+	};
+
+	// Sorts the symbols appended by a bulk insertion, keeping the first name of each address
+	void sort();
+
+	// Sorted by address, unique addresses
+	std::vector<Symbol> symbols;
+	// Pool of all names
+	std::string names;
+};
@@ -0,0 +1,56 @@
+#pragma once
+
+///
+/// Static best and worst case cycle analysis of routines
+///
+
+#include <cstdint>
+#include <map>
+#include <span>
+#include <vector>
+
+
+// Computes the best and worst case number of cycles of a routine, walking its control flow
+// graph with the cycles of mos6502's lookup table plus page crossing and branch penalties
+class CycleAnalyzer
+{
+public:
+
+	// Number of cycles of a routine, from its first instruction to its RTS/RTI included
+	struct Timing {
+		uint64_t best  = 0;
+		uint64_t worst = 0;
+		// False if a loop has no bound or the flow can't be followed (see below),
+		// then best and worst only cover the paths that could be analyzed
+		bool bounded = true;
+		// Headers of the loops without a bound, their body is counted once
+		std::vector<uint16_t> unbounded_loops;
+		// Instructions the flow can't be followed through (JMP indirect, BRK, KIL, recursive JSR)
+		std::vector<uint16_t> unresolved;
+	};
+
+	// The memory image must outlive the analyzer
+	explicit CycleAnalyzer(std::span<const uint8_t, 0x10000> memory);
+
+	// Sets how many times the header of a loop (the target of its backward jump) is executed
+	// every time the loop is entered, at least once
+	void setLoopBound(uint16_t header, uint32_t min, uint32_t max);
+
+	// Analyzes the routine starting at entry, called routines are analyzed (once) as well
+	Timing analyze(uint16_t entry);
+
+private:
+
+	struct LoopBound {
+		uint32_t min;
+		uint32_t max;
+	};
+
+	std::span<const uint8_t, 0x10000> memory;
+
+	std::map<uint16_t, LoopBound> bounds;
+	// Routines already analyzed
+	std::map<uint16_t, Timing> routines;
+	// Routines being analyzed, to detect recursion
+	std::vector<uint16_t> call_stack;
+};
@@ -0,0 +1,394 @@
+///
+/// Differential fuzzer: runs random programs and machine states on the reference core (clock())
+/// and on another execution core in lockstep, stopping on the first divergence and printing a minimized reproducer
+///
+
+#include <cstdint>
+#include <algorithm>
+#include <atomic>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <memory>
+#include <mutex>
+#include <optional>
+#include <random>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "../mos6502.h"
+
+
+// An execution core: a way to run the CPU an instruction at a time
+struct Core {
+	const char* name;
+	void (*execute)(mos6502& cpu);	// Executes a whole instruction
+	void (*complete)(mos6502& cpu);	// Completes the cycles of an interrupt sequence
+};
+
+
+// The first core is the reference
+static const Core cores[] = {
+	{ "clock", [](mos6502& cpu) { while (!cpu.clock()); }, [](mos6502& cpu) { while (!cpu.clock()); } },
+	{ "step",  [](mos6502& cpu) { cpu.step(); }, [](mos6502& cpu) { cpu.finish(); } },
+#ifndef CMOS_65C02
+	{ "tick",  [](mos6502& cpu) { while (!cpu.tick()); }, [](mos6502& cpu) { while (!cpu.tick()); } },
+#endif
+};
+
+
+// Interrupt requested after an instruction
+struct Interrupt {
+	uint32_t after;		// Index of the instruction
+	bool	 nmi;
+};
+
+
+// A random program and machine state
+struct Case {
+	uint8_t	 A, X, Y, P, SP;
+	uint16_t PC;
+	std::vector<uint8_t>   memory;
+	std::vector<Interrupt> interrupts;	// Sorted by instruction
+	uint32_t length;					// Number of instructions to execute
+};
+
+
+// First difference between the two cores
+struct Divergence {
+	uint32_t	instruction;	// Index of the instruction after which the states differ
+	std::string what;			// Description of the difference
+};
+
+
+// The emulated machine
+struct Machine {
+	Bus		bus;
+	mos6502 cpu{ &bus };
+
+	Machine() { bus.cpu = &cpu; }
+
+	void load(const Case& test)
+	{
+		std::copy(test.memory.begin(), test.memory.end(), bus.ram.begin());
+
+		cpu = mos6502{ &bus };
+		cpu.A = test.A;
+		cpu.X = test.X;
+		cpu.Y = test.Y;
+		cpu.P = test.P;
+		cpu.SP = test.SP;
+		cpu.PC = test.PC;
+	}
+};
+
+
+static Case generate(uint64_t seed, uint32_t length)
+{
+	std::mt19937_64 random{ seed };
+
+	Case test;
+	test.A = static_cast<uint8_t>(random());
+	test.X = static_cast<uint8_t>(random());
+	test.Y = static_cast<uint8_t>(random());
+	test.P = static_cast<uint8_t>(random()) | mos6502::U;
+	test.SP = static_cast<uint8_t>(random());
+	test.PC = static_cast<uint16_t>(random());
+	test.length = length;
+
+	test.memory.resize(0x10000);
+	for (std::size_t i = 0; i < test.memory.size(); i += 8)
+	{
+		uint64_t bytes = random();
+		std::memcpy(&test.memory[i], &bytes, 8);
+	}
+
+	// An interrupt every 16 instructions on average
+	for (uint32_t i = 0; i < length; ++i)
+	{
+		if (random() % 16 == 0)
+			test.interrupts.push_back({ i, random() % 4 == 0 });
+	}
+
+	return test;
+}
+
+
+// Describes the first difference between two machines, if any
+static std::optional<std::string> compare(const Machine& reference, const Machine& other)
+{
+	char text[128];
+
+	auto registers = [&](const char* name, unsigned expected, unsigned found) {
+		std::snprintf(text, sizeof(text), "%s: expected $%02X, found $%02X", name, expected, found);
+		return std::string{ text };
+	};
+
+	const mos6502& r = reference.cpu;
+	const mos6502& o = other.cpu;
+
+	if (r.PC != o.PC)
+	{
+		std::snprintf(text, sizeof(text), "PC: expected $%04X, found $%04X", r.PC, o.PC);
+		return text;
+	}
+	if (r.A != o.A)
+		return registers("A", r.A, o.A);
+	if (r.X != o.X)
+		return registers("X", r.X, o.X);
+	if (r.Y != o.Y)
+		return registers("Y", r.Y, o.Y);
+	if (r.P != o.P)
+		return registers("P", r.P, o.P);
+	if (r.SP != o.SP)
+		return registers("SP", r.SP, o.SP);
+	if (r.clock_count != o.clock_count)
+	{
+		std::snprintf(text, sizeof(text), "cycles: expected %llu, found %llu",
+			static_cast<unsigned long long>(r.clock_count), static_cast<unsigned long long>(o.clock_count));
+		return text;
+	}
+
+	if (std::memcmp(reference.bus.ram.data(), other.bus.ram.data(), reference.bus.ram.size()) != 0)
+	{
+		auto [expected, found] = std::mismatch(reference.bus.ram.begin(), reference.bus.ram.end(), other.bus.ram.begin());
+		std::snprintf(text, sizeof(text), "memory $%04X: expected $%02X, found $%02X",
+			static_cast<unsigned>(expected - reference.bus.ram.begin()), *expected, *found);
+		return text;
+	}
+
+	return std::nullopt;
+}
+
+
+// Runs the case on both cores in lockstep, returns the first divergence
+static std::optional<Divergence> run(const Case& test, const Core& core, Machine& reference, Machine& other)
+{
+	reference.load(test);
+	other.load(test);
+
+	auto interrupt = test.interrupts.begin();
+
+	for (uint32_t i = 0; i < test.length; ++i)
+	{
+		cores[0].execute(reference.cpu);
+		core.execute(other.cpu);
+
+		for (; interrupt != test.interrupts.end() && interrupt->after == i; ++interrupt)
+		{
+			// An IRQ is ignored when the I flag is set, and every interrupt after a KIL or STP:
+			// they have no cycles to complete
+			auto request = [&](mos6502& cpu, const Core& executor) {
+				if (cpu.halted() == mos6502::Halt::Jam || cpu.halted() == mos6502::Halt::Stop)
+					return;
+
+				if (interrupt->nmi)
+					cpu.nmi();
+				else if (!(cpu.P & mos6502::I))
+					cpu.irq();
+				else
+					return;
+
+				executor.complete(cpu);
+			};
+
+			request(reference.cpu, cores[0]);
+			request(other.cpu, core);
+		}
+
+		if (auto difference = compare(reference, other))
+			return Divergence{ i, *difference };
+
+		// A halted CPU makes no progress, step() doesn't even count idle cycles
+		if (reference.cpu.halted() != mos6502::Halt::None)
+			break;
+	}
+
+	return std::nullopt;
+}
+
+
+// Shrinks a failing case, keeping it failing: drops the instructions after the divergence and
+// the interrupts, then clears as much memory as possible, in halving chunks
+static Case minimize(Case test, const Core& core, Machine& reference, Machine& other)
+{
+	auto fails = [&](const Case& candidate) { return run(candidate, core, reference, other).has_value(); };
+
+	test.length = run(test, core, reference, other)->instruction + 1;
+	test.interrupts.erase(std::remove_if(test.interrupts.begin(), test.interrupts.end(),
+		[&](const Interrupt& interrupt) { return interrupt.after >= test.length; }), test.interrupts.end());
+
+	for (std::size_t i = test.interrupts.size(); i-- > 0; )
+	{
+		Case candidate = test;
+		candidate.interrupts.erase(candidate.interrupts.begin() + i);
+		if (fails(candidate))
+			test = std::move(candidate);
+	}
+
+	for (std::size_t chunk = test.memory.size() / 2; chunk > 0; chunk /= 2)
+	{
+		for (std::size_t start = 0; start < test.memory.size(); start += chunk)
+		{
+			auto begin = test.memory.begin() + start;
+			if (std::all_of(begin, begin + chunk, [](uint8_t byte) { return byte == 0; }))
+				continue;
+
+			Case candidate = test;
+			std::fill_n(candidate.memory.begin() + start, chunk, 0);
+			if (fails(candidate))
+				test = std::move(candidate);
+		}
+	}
+
+	test.length = run(test, core, reference, other)->instruction + 1;
+	return test;
+}
+
+
+// Prints the case: initial state, interrupts, non zero memory and the instructions executed by the reference core
+static void printReproducer(const Case& test, const Divergence& divergence, const Core& core)
+{
+	std::printf("Divergence between %s and %s after instruction %u: %s\n\n",
+		cores[0].name, core.name, divergence.instruction, divergence.what.c_str());
+
+	std::printf("A=$%02X X=$%02X Y=$%02X P=$%02X SP=$%02X PC=$%04X\n", test.A, test.X, test.Y, test.P, test.SP, test.PC);
+
+	for (const Interrupt& interrupt : test.interrupts)
+		std::printf("%s after instruction %u\n", interrupt.nmi ? "NMI" : "IRQ", interrupt.after);
+
+	std::printf("\nMemory (zero elsewhere):\n");
+	for (std::size_t line = 0; line < test.memory.size(); line += 16)
+	{
+		auto begin = test.memory.begin() + line;
+		if (std::all_of(begin, begin + 16, [](uint8_t byte) { return byte == 0; }))
+			continue;
+
+		std::printf("$%04X:", static_cast<unsigned>(line));
+		for (std::size_t i = 0; i < 16; ++i)
+			std::printf(" %02X", test.memory[line + i]);
+		std::printf("\n");
+	}
+
+	std::printf("\nInstructions:\n");
+
+	auto machine = std::make_unique<Machine>();
+	machine->load(test);
+
+	for (uint32_t i = 0; i < test.length; ++i)
+	{
+		char text[mos6502::max_format_length];
+		mos6502::format(machine->cpu.decode(machine->cpu.PC), text);
+		std::printf("%4u  $%04X  %s\n", i, machine->cpu.PC, text);
+
+		cores[0].execute(machine->cpu);
+	}
+}
+
+
+static void usage(const char* program)
+{
+	std::fprintf(stderr,
+		"Usage: %s [options]\n"
+		"  --core <name>      Core compared with clock() (default step)\n"
+		"  --cases <n>        Number of random cases (default 100000)\n"
+		"  --length <n>       Instructions per case (default 64)\n"
+		"  --seed <n>         Seed of the first case (default 1)\n"
+		"  --threads <n>      Worker threads (default: hardware threads)\n",
+		program);
+}
+
+
+int main(int argc, char* argv[])
+{
+	const Core* core = &cores[1];
+	uint64_t case_count = 100000;
+	uint32_t length = 64;
+	uint64_t seed = 1;
+	unsigned threads = std::max(1u, std::thread::hardware_concurrency());
+
+	for (int i = 1; i < argc; ++i)
+	{
+		std::string option = argv[i];
+
+		if (i + 1 == argc)
+		{
+			usage(argv[0]);
+			return 2;
+		}
+
+		const char* value = argv[++i];
+
+		if (option == "--core")
+		{
+			auto found = std::find_if(std::begin(cores) + 1, std::end(cores),
+				[&](const Core& candidate) { return value == std::string{ candidate.name }; });
+			if (found == std::end(cores))
+			{
+				std::fprintf(stderr, "Unknown core %s\n", value);
+				return 2;
+			}
+			core = found;
+		}
+		else if (option == "--cases")
+			case_count = std::strtoull(value, nullptr, 10);
+		else if (option == "--length")
+			length = std::max(1ul, std::strtoul(value, nullptr, 10));
+		else if (option == "--seed")
+			seed = std::strtoull(value, nullptr, 10);
+		else if (option == "--threads")
+			threads = std::max(1ul, std::strtoul(value, nullptr, 10));
+		else
+		{
+			usage(argv[0]);
+			return 2;
+		}
+	}
+
+	std::atomic<uint64_t> next{ 0 };
+	std::atomic<bool> failed{ false };
+
+	// The failing case with the lowest index, so that the result doesn't depend on the scheduling
+	std::mutex mutex;
+	std::optional<uint64_t> failure;
+
+	auto worker = [&]() {
+		auto reference = std::make_unique<Machine>();
+		auto other = std::make_unique<Machine>();
+
+		for (uint64_t index = next++; index < case_count && !failed; index = next++)
+		{
+			if (run(generate(seed + index, length), *core, *reference, *other))
+			{
+				std::lock_guard lock{ mutex };
+				if (!failure || index < *failure)
+					failure = index;
+				failed = true;
+			}
+		}
+	};
+
+	std::vector<std::thread> pool;
+	for (unsigned i = 0; i < threads; ++i)
+		pool.emplace_back(worker);
+	for (std::thread& thread : pool)
+		thread.join();
+
+	if (!failure)
+	{
+		std::printf("%llu cases of %u instructions: %s matches %s\n",
+			static_cast<unsigned long long>(case_count), length, core->name, cores[0].name);
+		return 0;
+	}
+
+	auto reference = std::make_unique<Machine>();
+	auto other = std::make_unique<Machine>();
+
+	std::printf("Case with seed %llu diverges, minimizing\n\n", static_cast<unsigned long long>(seed + *failure));
+
+	Case test = minimize(generate(seed + *failure, length), *core, *reference, *other);
+	printReproducer(test, *run(test, *core, *reference, *other), *core);
+
+	return 1;
+}
@@ -0,0 +1,574 @@
+///
+/// Runs the per-opcode test vectors of SingleStepTests/ProcessorTests (https://github.com/SingleStepTests/65x02),
+/// checking the final state and the sequence of bus accesses of every instruction. Requires MEMORY_HOOKS
+///
+
+#include <cstdint>
+#include <algorithm>
+#include <atomic>
+#include <cstdio>
+#include <cstdlib>
+#include <filesystem>
+#include <memory>
+#include <stdexcept>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "../mos6502.h"
+
+#ifndef MEMORY_HOOKS
+#error "singlestep requires MEMORY_HOOKS"
+#endif
+
+
+// A bus access: one per cycle in the test vectors
+struct Access {
+	uint16_t address;
+	uint8_t	 data;
+	bool	 write;
+
+	bool operator==(const Access&) const = default;
+};
+
+
+// State of the CPU and of the memory used by a test
+struct State {
+	uint16_t PC = 0;
+	uint8_t	 SP = 0, A = 0, X = 0, Y = 0, P = 0;
+	std::vector<std::pair<uint16_t, uint8_t>> ram;
+};
+
+
+struct Test {
+	std::string name;
+	State initial;
+	State final;
+	std::vector<Access> cycles;
+};
+
+
+// Results of a file
+struct Report {
+	std::string file;
+	uint64_t tests = 0;
+	uint64_t state_failures = 0;	// Registers or memory differ
+	uint64_t cycle_failures = 0;	// The number of cycles differs
+	uint64_t bus_failures = 0;		// The sequence of accesses differs
+	std::string first_failure;		// Description of the first failed test
+	std::string error;				// Parse error
+};
+
+
+// Pull parser that reads a JSON file a buffer at a time, so that a file is never loaded as a whole
+class JsonReader
+{
+public:
+	explicit JsonReader(const std::filesystem::path& path)
+		: file{ std::fopen(path.string().c_str(), "rb") }
+	{
+		if (!file)
+			throw std::runtime_error{ "Can't open " + path.string() };
+	}
+
+	~JsonReader() { std::fclose(file); }
+
+	JsonReader(const JsonReader&) = delete;
+	JsonReader& operator=(const JsonReader&) = delete;
+
+	// Returns the next non blank character without consuming it, 0 at the end of the file
+	char peek()
+	{
+		while (true)
+		{
+			if (position == size && !refill())
+				return 0;
+
+			char c = buffer[position];
+			if (c != ' ' && c != '\n' && c != '\r' && c != '\t')
+				return c;
+
+			++position;
+		}
+	}
+
+	// Consumes the next non blank character, that must be c
+	void expect(char c)
+	{
+		if (peek() != c)
+			throw std::runtime_error{ std::string{ "expected '" } + c + "'" };
+		++position;
+	}
+
+	// Consumes c if it's the next non blank character
+	bool accept(char c)
+	{
+		if (peek() != c)
+			return false;
+		++position;
+		return true;
+	}
+
+	std::string string()
+	{
+		expect('"');
+
+		std::string result;
+		while (true)
+		{
+			char c = next();
+			if (c == '"')
+				return result;
+			if (c == '\\')
+				c = next();
+			result += c;
+		}
+	}
+
+	int64_t integer()
+	{
+		peek();
+
+		bool negative = false;
+		if (buffer[position] == '-')
+		{
+			negative = true;
+			++position;
+		}
+
+		int64_t value = 0;
+		bool digits = false;
+		while ((position < size || refill()) && buffer[position] >= '0' && buffer[position] <= '9')
+		{
+			value = value * 10 + (buffer[position++] - '0');
+			digits = true;
+		}
+
+		if (!digits)
+			throw std::runtime_error{ "expected a number" };
+
+		return negative ? -value : value;
+	}
+
+	// Skips any value
+	void skip()
+	{
+		char c = peek();
+
+		if (c == '"')
+			string();
+		else if (c == '{')
+			object([this](const std::string&) { skip(); });
+		else if (c == '[')
+			array([this]() { skip(); });
+		else
+		{
+			// Numbers, true, false, null
+			while ((position < size || refill()) && buffer[position] != ',' && buffer[position] != '}' && buffer[position] != ']')
+				++position;
+		}
+	}
+
+	// Parses an object, calling member(key) to parse the value of every member
+	template <typename Member>
+	void object(Member member)
+	{
+		expect('{');
+		if (accept('}'))
+			return;
+
+		do
+		{
+			std::string key = string();
+			expect(':');
+			member(key);
+		} while (accept(','));
+
+		expect('}');
+	}
+
+	// Parses an array, calling element() to parse every element
+	template <typename Element>
+	void array(Element element)
+	{
+		expect('[');
+		if (accept(']'))
+			return;
+
+		do
+			element();
+		while (accept(','));
+
+		expect(']');
+	}
+
+private:
+	char next()
+	{
+		if (position == size && !refill())
+			throw std::runtime_error{ "unexpected end of file" };
+		return buffer[position++];
+	}
+
+	bool refill()
+	{
+		size = std::fread(buffer, 1, sizeof(buffer), file);
+		position = 0;
+		return size > 0;
+	}
+
+	std::FILE* file;
+	char buffer[1 << 16];
+	std::size_t size = 0;
+	std::size_t position = 0;
+};
+
+
+static State parseState(JsonReader& json)
+{
+	State state;
+
+	json.object([&](const std::string& key) {
+		if (key == "pc")
+			state.PC = static_cast<uint16_t>(json.integer());
+		else if (key == "s")
+			state.SP = static_cast<uint8_t>(json.integer());
+		else if (key == "a")
+			state.A = static_cast<uint8_t>(json.integer());
+		else if (key == "x")
+			state.X = static_cast<uint8_t>(json.integer());
+		else if (key == "y")
+			state.Y = static_cast<uint8_t>(json.integer());
+		else if (key == "p")
+			state.P = static_cast<uint8_t>(json.integer());
+		else if (key == "ram")
+		{
+			json.array([&]() {
+				json.expect('[');
+				uint16_t address = static_cast<uint16_t>(json.integer());
+				json.expect(',');
+				uint8_t data = static_cast<uint8_t>(json.integer());
+				json.expect(']');
+				state.ram.emplace_back(address, data);
+			});
+		}
+		else
+			json.skip();
+	});
+
+	return state;
+}
+
+
+static Test parseTest(JsonReader& json)
+{
+	Test test;
+
+	json.object([&](const std::string& key) {
+		if (key == "name")
+			test.name = json.string();
+		else if (key == "initial")
+			test.initial = parseState(json);
+		else if (key == "final")
+			test.final = parseState(json);
+		else if (key == "cycles")
+		{
+			json.array([&]() {
+				json.expect('[');
+				uint16_t address = static_cast<uint16_t>(json.integer());
+				json.expect(',');
+				uint8_t data = static_cast<uint8_t>(json.integer());
+				json.expect(',');
+				bool write = json.string() == "write";
+				json.expect(']');
+				test.cycles.push_back({ address, data, write });
+			});
+		}
+		else
+			json.skip();
+	});
+
+	return test;
+}
+
+
+// Records the bus accesses of the instruction
+class AccessHooks : public NoHooks
+{
+public:
+	static constexpr bool memory = true;
+
+	void read(uint16_t address, uint8_t data)  { accesses.push_back({ address, data, false }); }
+	void write(uint16_t address, uint8_t data) { accesses.push_back({ address, data, true }); }
+
+	std::vector<Access> accesses;
+};
+
+
+// How the tests are run. Only the microcoded core makes the accesses of the hardware (dummy reads,
+// double writes of read-modify-write): step(), and the 65C02 that has no microcoded core, are checked
+// without the bus
+#ifdef CMOS_65C02
+static constexpr bool has_tick = false;
+#else
+static constexpr bool has_tick = true;
+#endif
+
+struct Options {
+	bool check_bus = has_tick;	// Compare the sequence of bus accesses
+	bool tick = has_tick;		// Run the microcoded core (tick()) instead of step()
+};
+
+
+// The emulated machine
+struct Machine {
+	Bus		bus;
+	mos6502 cpu{ &bus };
+
+	Machine() { bus.cpu = &cpu; }
+};
+
+
+// Runs a test, returns the description of its failure or an empty string
+static std::string run(const Test& test, Machine& machine, Report& report, const Options& options)
+{
+	mos6502& cpu = machine.cpu;
+
+	cpu = mos6502{ &machine.bus };
+	cpu.PC = test.initial.PC;
+	cpu.SP = test.initial.SP;
+	cpu.A = test.initial.A;
+	cpu.X = test.initial.X;
+	cpu.Y = test.initial.Y;
+	cpu.P = test.initial.P;
+
+	for (auto [address, data] : test.initial.ram)
+		machine.bus.ram[address] = data;
+
+	AccessHooks hooks;
+	unsigned cycles = 0;
+
+#ifndef CMOS_65C02
+	if (options.tick)
+	{
+		do
+			++cycles;
+		while (!cpu.tick(hooks));
+	}
+	else
+#endif
+		cycles = cpu.step(hooks);
+
+	std::string failure;
+	char text[96];
+
+	auto compare = [&](const char* name, unsigned found, unsigned expected) {
+		if (found != expected && failure.empty())
+		{
+			std::snprintf(text, sizeof(text), "%s = $%02X, expected $%02X", name, found, expected);
+			failure = text;
+		}
+	};
+
+	compare("PC", cpu.PC, test.final.PC);
+	compare("SP", cpu.SP, test.final.SP);
+	compare("A", cpu.A, test.final.A);
+	compare("X", cpu.X, test.final.X);
+	compare("Y", cpu.Y, test.final.Y);
+	compare("P", cpu.P, test.final.P);
+
+	for (auto [address, data] : test.final.ram)
+	{
+		char name[8];
+		std::snprintf(name, sizeof(name), "[$%04X]", address);
+		compare(name, machine.bus.ram[address], data);
+	}
+
+	if (!failure.empty())
+		++report.state_failures;
+
+	if (cycles != test.cycles.size())
+	{
+		++report.cycle_failures;
+		if (failure.empty())
+		{
+			std::snprintf(text, sizeof(text), "%u cycles, expected %zu", cycles, test.cycles.size());
+			failure = text;
+		}
+	}
+
+	if (options.check_bus && hooks.accesses != test.cycles)
+	{
+		++report.bus_failures;
+		if (failure.empty())
+		{
+			auto [found, expected] = std::mismatch(hooks.accesses.begin(), hooks.accesses.end(), test.cycles.begin(), test.cycles.end());
+			std::size_t cycle = found - hooks.accesses.begin();
+
+			if (found == hooks.accesses.end())
+				std::snprintf(text, sizeof(text), "bus: %zu accesses, expected %zu", hooks.accesses.size(), test.cycles.size());
+			else if (expected == test.cycles.end())
+				std::snprintf(text, sizeof(text), "bus: extra access in cycle %zu", cycle + 1);
+			else
+				std::snprintf(text, sizeof(text), "bus cycle %zu: %s $%04X = $%02X, expected %s $%04X = $%02X", cycle + 1,
+					found->write ? "write" : "read", found->address, found->data,
+					expected->write ? "write" : "read", expected->address, expected->data);
+			failure = text;
+		}
+	}
+
+	// Clears the memory used by the test for the next one
+	for (auto [address, data] : test.initial.ram)
+		machine.bus.ram[address] = 0;
+	for (auto [address, data] : test.final.ram)
+		machine.bus.ram[address] = 0;
+	for (const Access& access : test.cycles)
+		machine.bus.ram[access.address] = 0;
+	for (const Access& access : hooks.accesses)
+		machine.bus.ram[access.address] = 0;
+
+	return failure;
+}
+
+
+// Streams the tests of a file, running each one as soon as it's parsed
+static Report runFile(const std::filesystem::path& path, Machine& machine, const Options& options)
+{
+	Report report;
+	report.file = path.filename().string();
+
+	try
+	{
+		JsonReader json{ path };
+
+		json.array([&]() {
+			Test test = parseTest(json);
+			++report.tests;
+
+			std::string failure = run(test, machine, report, options);
+			if (!failure.empty() && report.first_failure.empty())
+				report.first_failure = "\"" + test.name + "\": " + failure;
+		});
+	}
+	catch (const std::exception& e)
+	{
+		report.error = e.what();
+	}
+
+	return report;
+}
+
+
+static void usage(const char* program)
+{
+	std::fprintf(stderr,
+		"Usage: %s [options] <file.json | directory>...\n"
+#ifdef CMOS_65C02
+		"Checks the final state and the number of cycles: the 65C02 core makes its accesses\n"
+		"at once (no dummy reads), its bus sequence doesn't match the test vectors\n"
+#else
+		"Runs the microcoded core (tick()) and checks the final state, the number of cycles\n"
+		"and the sequence of bus accesses\n"
+		"  --no-bus           Checks only the final state and the number of cycles\n"
+		"  --step             Runs step() instead, that makes no dummy accesses (implies --no-bus)\n"
+#endif
+		"  --threads <n>      Worker threads (default: hardware threads)\n"
+		"  --verbose          Reports the files that pass too\n",
+		program);
+}
+
+
+int main(int argc, char* argv[])
+{
+	std::vector<std::filesystem::path> files;
+	Options options;
+	bool verbose = false;
+	unsigned threads = std::max(1u, std::thread::hardware_concurrency());
+
+	for (int i = 1; i < argc; ++i)
+	{
+		std::string argument = argv[i];
+
+		if (argument == "--verbose")
+			verbose = true;
+#ifndef CMOS_65C02
+		else if (argument == "--no-bus")
+			options.check_bus = false;
+		else if (argument == "--step")
+			options = { false, false };
+#endif
+		else if (argument == "--threads" && i + 1 < argc)
+			threads = std::max(1ul, std::strtoul(argv[++i], nullptr, 10));
+		else if (argument.starts_with("--"))
+		{
+			usage(argv[0]);
+			return 2;
+		}
+		else if (std::filesystem::is_directory(argument))
+		{
+			for (const auto& entry : std::filesystem::directory_iterator{ argument })
+			{
+				if (entry.path().extension() == ".json")
+					files.push_back(entry.path());
+			}
+		}
+		else
+			files.push_back(argument);
+	}
+
+	if (files.empty())
+	{
+		usage(argv[0]);
+		return 2;
+	}
+
+	std::sort(files.begin(), files.end());
+
+	// Files are spread across the threads, every file is streamed by a single thread
+	std::vector<Report> reports(files.size());
+	std::atomic<std::size_t> next{ 0 };
+
+	auto worker = [&]() {
+		auto machine = std::make_unique<Machine>();
+
+		for (std::size_t index = next++; index < files.size(); index = next++)
+			reports[index] = runFile(files[index], *machine, options);
+	};
+
+	std::vector<std::thread> pool;
+	for (unsigned i = 0; i < std::min<std::size_t>(threads, files.size()); ++i)
+		pool.emplace_back(worker);
+	for (std::thread& thread : pool)
+		thread.join();
+
+	Report total;
+	std::size_t failed_files = 0;
+
+	for (const Report& report : reports)
+	{
+		total.tests += report.tests;
+		total.state_failures += report.state_failures;
+		total.cycle_failures += report.cycle_failures;
+		total.bus_failures += report.bus_failures;
+
+		bool failed = report.state_failures || report.cycle_failures || report.bus_failures || !report.error.empty();
+		failed_files += failed;
+
+		if (!report.error.empty())
+			std::printf("%s: %s after %llu tests\n", report.file.c_str(), report.error.c_str(), static_cast<unsigned long long>(report.tests));
+		else if (failed || verbose)
+		{
+			std::printf("%s: %llu tests, %llu state, %llu cycle count, %llu bus failures%s%s\n", report.file.c_str(),
+				static_cast<unsigned long long>(report.tests), static_cast<unsigned long long>(report.state_failures),
+				static_cast<unsigned long long>(report.cycle_failures), static_cast<unsigned long long>(report.bus_failures),
+				report.first_failure.empty() ? "" : ", first: ", report.first_failure.c_str());
+		}
+	}
+
+	std::printf("%zu files, %zu failed; %llu tests, %llu state, %llu cycle count, %llu bus failures\n",
+		files.size(), failed_files, static_cast<unsigned long long>(total.tests),
+		static_cast<unsigned long long>(total.state_failures), static_cast<unsigned long long>(total.cycle_failures),
+		static_cast<unsigned long long>(total.bus_failures));
+
+	return failed_files ? 1 : 0;
+}
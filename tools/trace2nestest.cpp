@@ -0,0 +1,45 @@
+///
+/// Converts a binary trace written by TraceWriter to a nestest-like text log
+///
+
+#include <cstdio>
+#include <exception>
+#include <fstream>
+#include <iostream>
+
+#include "../trace.h"
+
+
+int main(int argc, char* argv[])
+{
+	if (argc < 2 || argc > 3)
+	{
+		std::fprintf(stderr, "Usage: %s <trace> [output]\n", argv[0]);
+		return 2;
+	}
+
+	try
+	{
+		TraceReader reader{ argv[1] };
+
+		if (argc == 3)
+		{
+			std::ofstream out{ argv[2] };
+			if (!out)
+			{
+				std::fprintf(stderr, "Can't open %s\n", argv[2]);
+				return 1;
+			}
+			writeNestestLog(reader, out);
+		}
+		else
+			writeNestestLog(reader, std::cout);
+	}
+	catch (const std::exception& error)
+	{
+		std::fprintf(stderr, "%s\n", error.what());
+		return 1;
+	}
+
+	return 0;
+}
@@ -0,0 +1,160 @@
+#pragma once
+
+///
+/// Compact binary execution trace, written by a background thread
+///
+
+#include <cstdint>
+#include <array>
+#include <atomic>
+#include <cstdio>
+#include <memory>
+#include <ostream>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "mos6502.h"
+
+
+class TraceCodeCache;
+
+
+// State of the CPU before the execution of an instruction
+struct TraceRecord {
+	uint64_t cycle;			// mos6502::clock_count
+	uint16_t pc;
+	uint8_t	 opcode;
+	uint8_t	 operands[2];	// Only the first mos6502::length(opcode) - 1 are meaningful
+	uint8_t	 A, X, Y, P, SP;
+};
+
+
+// Trace file format:
+//	 header: "6502TRC" followed by the version byte
+//	 blocks: raw size (u32), compressed size (u32), number of records (u32), compressed data
+// Every block is compressed independently with a small LZ77 coder; inside a block, records are
+// delta encoded against the previous one, so a block can be decoded without the previous ones.
+// A record starts with a byte whose bits tell which fields follow (see src/trace.cpp)
+
+
+// Writes a trace from the emulation thread: records are pushed in a lock-free
+// single producer ring buffer, encoded and written to the file by a background thread
+class TraceWriter
+{
+public:
+
+	// Opens the file (throws std::system_error on failure) and starts the writer thread
+	// The ring capacity is rounded up to a power of two
+	explicit TraceWriter(const std::string& path, std::size_t ring_capacity = 1 << 16);
+	~TraceWriter();
+
+	TraceWriter(const TraceWriter&) = delete;
+	TraceWriter& operator=(const TraceWriter&) = delete;
+
+	// Records the state of cpu before the instruction at PC
+	void record(const mos6502& cpu);
+
+	// Records the state of cpu and executes the instruction with mos6502::step()
+	uint8_t step(mos6502& cpu);
+
+	// Pushes a record in the ring, waits if the writer thread is behind
+	void push(const TraceRecord& record);
+
+	// Writes every pending record and closes the file, further records are ignored. Throws
+	// std::system_error if a write failed (disk full): the trace is truncated. Without a call to
+	// close(), the destructor prints the error on stderr
+	void close();
+
+	// Number of records pushed
+	uint64_t records() const;
+	// Number of times push() had to wait for room in the ring
+	uint64_t stalls() const;
+
+private:
+
+	// Body of the writer thread
+	void writerLoop();
+	// Compresses and writes the current block
+	void flushBlock();
+
+private:
+
+	// Ring buffer, head is written only by the producer and tail only by the consumer
+	std::vector<TraceRecord> ring;
+	std::size_t mask;
+	alignas(64) std::atomic<std::size_t> head{ 0 };
+	alignas(64) std::atomic<std::size_t> tail{ 0 };
+	alignas(64) std::atomic<bool> closing{ false };
+
+	uint64_t pushed = 0;
+	uint64_t waits  = 0;
+
+	std::string path;
+
+	// Owned by the writer thread
+	std::FILE* file = nullptr;
+	// errno of the first failed write, read by close() after the thread has ended
+	int write_error = 0;
+	std::unique_ptr<TraceCodeCache> cache;
+	std::vector<uint8_t> block;
+	std::vector<uint8_t> compressed;
+	uint32_t block_records = 0;
+	TraceRecord previous{ };
+
+	std::thread writer;
+};
+
+
+// Hooks that record every instruction in a trace, before it is executed
+class TraceHooks : public NoHooks
+{
+public:
+	explicit TraceHooks(TraceWriter& writer)
+		: writer{ writer }
+	{ }
+
+	void beforeInstruction(const mos6502& cpu) { writer.record(cpu); }
+
+private:
+	TraceWriter& writer;
+};
+
+
+// Reads a trace written by TraceWriter
+class TraceReader
+{
+public:
+
+	// Opens the file, throws std::system_error or std::runtime_error on failure
+	explicit TraceReader(const std::string& path);
+	~TraceReader();
+
+	TraceReader(const TraceReader&) = delete;
+	TraceReader& operator=(const TraceReader&) = delete;
+
+	// Reads the next record, returns false at the end of the trace
+	// Throws std::runtime_error if the file is corrupted
+	bool next(TraceRecord& record);
+
+private:
+	// Reads and decompresses the next block, returns false at the end of the file
+	bool readBlock();
+
+private:
+	std::FILE* file = nullptr;
+	std::unique_ptr<TraceCodeCache> cache;
+	std::vector<uint8_t> block;
+	std::vector<uint8_t> compressed;
+	std::size_t position = 0;
+	uint32_t remaining = 0;
+	TraceRecord previous{ };
+};
+
+
+// Converts a trace in a nestest-like text log
+// ("C000  4C F5 C5  JMP $C5F5                       A:00 X:00 Y:00 P:24 SP:FD CYC:7").
+// Undocumented opcodes get the '*' prefix of nestest, under the names of the disassembler (AAX, ISC...).
+// Omitted columns: the "= XX" and "@ XXXX" annotations of memory operands (the trace has no memory
+// contents) and the PPU position. Returns the number of records converted
+uint64_t writeNestestLog(TraceReader& reader, std::ostream& out);
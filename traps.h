@@ -0,0 +1,48 @@
+#pragma once
+
+///
+/// High level emulation of ROM routines
+///
+
+#include <cstdint>
+#include <array>
+#include <functional>
+#include <unordered_map>
+
+class mos6502;
+
+
+// Native handlers that replace the routines at some addresses, used by mos6502 when it's compiled with
+// HLE_TRAPS and its traps member points to an instance. When PC reaches a trapped address (after JSR
+// or any jump) the handler runs instead of the routine, then the CPU returns as RTS does
+class TrapTable
+{
+public:
+
+	// A native routine: it works on the CPU registers and, through cpu.bus, on the memory.
+	// Returns the cycles the replaced routine would have taken, its RTS included (at least 1 is charged)
+	using Handler = std::function<uint32_t(mos6502& cpu)>;
+
+	// Replaces the routine at address with handler
+	void set(uint16_t address, Handler handler);
+	// Same as above, the routine always takes cycles
+	void set(uint16_t address, uint32_t cycles, std::function<void(mos6502& cpu)> handler);
+
+	// Removes the handler of address
+	void clear(uint16_t address);
+	// Removes every handler
+	void clear();
+
+	// True if address has a handler
+	bool test(uint16_t address) const { return (bits[address >> 6] >> (address & 63)) & 1; }
+
+	// Runs the handler of address, returns its cycles
+	uint32_t call(uint16_t address, mos6502& cpu) const;
+
+private:
+
+	// One bit per address, checked before every instruction
+	std::array<uint64_t, 1024> bits{ };
+
+	std::unordered_map<uint16_t, Handler> handlers;
+};